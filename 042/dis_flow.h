@@ -0,0 +1,407 @@
+#ifndef DIS_FLOW_H
+#define DIS_FLOW_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "lk_tracker.h"
+
+// 稠密逆向搜索 (Dense Inverse Search) 光流：
+// 每层金字塔上把图像铺满互相重叠的小块，每块用逆向组合 LK 只估计平移，初值来自上一层的稠密光流；
+// 然后按光度误差加权平均覆盖每个像素的各块的光流，得到该层的稠密光流 (densification)
+// 块的梯度和 Hessian 只来自 I0，迭代时只采样 I1；之后几轮空间传播让误差更小的相邻块的光流扩散开
+// 块之间、像素行之间都相互独立，用 OpenMP 并行
+// 未实现原文最后的变分细化，最细计算层以下的分辨率直接双线性上采样
+class DISFlow
+{
+public:
+    struct Options
+    {
+        int levels;             // 金字塔层数
+        int finest_level;       // 最细的计算层，0 为原图
+        int patch;              // 块边长
+        int stride;             // 块的间隔，小于 patch 时相邻块重叠
+        int iterations;         // 每块最大迭代次数
+        float epsilon;          // 更新量小于此值(像素)时停止
+        int propagation;        // 每层空间传播的轮数
+
+        Options() : levels(5), finest_level(1), patch(8), stride(4), iterations(16), epsilon(0.01f), propagation(2) {}
+    };
+
+    DISFlow(const Options& options = Options()) : options_(options) {}
+
+    // I0 到 I1 的稠密光流，flow 为 CV_32FC2，I0(x) 对应 I1(x + flow(x))
+    void calc(const cv::Mat& I0, const cv::Mat& I1, cv::Mat& flow)
+    {
+        from_.build(I0, options_.levels);
+        to_.build(I1, options_.levels);
+        calc(from_, to_, flow);
+    }
+
+    // 金字塔已建好时直接使用，连续帧之间可以复用；两个金字塔的层数不少于 options.levels
+    void calc(const LKPyramid& from, const LKPyramid& to, cv::Mat& flow)
+    {
+        const int ps = options_.patch;
+        int coarsest = options_.levels - 1;
+        while (coarsest > 0 && (from.gray[coarsest].cols < 2 * ps || from.gray[coarsest].rows < 2 * ps))
+            coarsest--;
+        const int finest = std::min(options_.finest_level, coarsest);
+
+        // 由粗到精，每层的稠密光流作为下一层各块的初值
+        for (int l = coarsest; l >= finest; l--)
+        {
+            const bool has_prior = l < coarsest;
+            if (has_prior)
+                std::swap(field_, prior_);
+            patchSearch(from, to, l, has_prior);
+            densify(from.gray[l], to.gray[l]);
+        }
+
+        // 上采样到原图分辨率
+        const int rows = from.gray[0].rows, cols = from.gray[0].cols;
+        const float scale = float(1 << finest);
+        flow.create(rows, cols, CV_32FC2);
+#pragma omp parallel for schedule(static)
+        for (int y = 0; y < rows; y++)
+        {
+            float* out = flow.ptr<float>(y);
+            const float fy = (y + 0.5f) / scale - 0.5f;
+            for (int x = 0; x < cols; x++)
+            {
+                const float fx = (x + 0.5f) / scale - 0.5f;
+                out[2 * x] = field_.sample(field_.u, fx, fy) * scale;
+                out[2 * x + 1] = field_.sample(field_.v, fx, fy) * scale;
+            }
+        }
+    }
+
+private:
+    // 一层的稠密光流
+    struct Field
+    {
+        int width = 0, height = 0;
+        std::vector<float> u, v;
+
+        void resize(int w, int h)
+        {
+            width = w;
+            height = h;
+            u.resize(w * h);
+            v.resize(w * h);
+        }
+
+        // 双线性插值，越界时取边界值
+        float sample(const std::vector<float>& f, float x, float y) const
+        {
+            x = std::min(std::max(x, 0.0f), float(width - 1));
+            y = std::min(std::max(y, 0.0f), float(height - 1));
+            const int x0 = std::min(int(x), width - 2 < 0 ? 0 : width - 2);
+            const int y0 = std::min(int(y), height - 2 < 0 ? 0 : height - 2);
+            const int x1 = std::min(x0 + 1, width - 1), y1 = std::min(y0 + 1, height - 1);
+            const float ax = x - x0, ay = y - y0;
+            const float top = (1 - ax) * f[y0 * width + x0] + ax * f[y0 * width + x1];
+            const float bottom = (1 - ax) * f[y1 * width + x0] + ax * f[y1 * width + x1];
+            return (1 - ay) * top + ay * bottom;
+        }
+    };
+
+    // 块的起点：间隔 stride 铺开，最后一块贴齐边界，保证每个像素都被覆盖
+    static void gridPositions(int n, int ps, int stride, std::vector<int>& pos)
+    {
+        pos.clear();
+        for (int p = 0; p + ps <= n; p += stride)
+            pos.push_back(p);
+        if (pos.empty() || pos.back() + ps < n)
+            pos.push_back(std::max(n - ps, 0));
+    }
+
+    // 每个坐标被哪些块覆盖：first[i]..last[i]，块按起点递增排列
+    static void coverRange(int n, int ps, const std::vector<int>& pos, std::vector<int>& first, std::vector<int>& last)
+    {
+        first.assign(n, 0);
+        last.assign(n, -1);
+        int a = 0, b = -1;
+        for (int i = 0; i < n; i++)
+        {
+            while (b + 1 < int(pos.size()) && pos[b + 1] <= i)
+                b++;
+            while (a <= b && pos[a] + ps <= i)
+                a++;
+            first[i] = a;
+            last[i] = b;
+        }
+    }
+
+    // 灰度双线性插值，越界时取边界值
+    static inline float intensity(const cv::Mat& img, float x, float y)
+    {
+        x = std::min(std::max(x, 0.0f), float(img.cols - 1));
+        y = std::min(std::max(y, 0.0f), float(img.rows - 1));
+        const int x0 = std::min(int(x), img.cols - 2), y0 = std::min(int(y), img.rows - 2);
+        const float ax = x - x0, ay = y - y0;
+        const uchar* r0 = img.ptr<uchar>(y0);
+        const uchar* r1 = img.ptr<uchar>(y0 + 1);
+        return (1 - ay) * ((1 - ax) * r0[x0] + ax * r0[x0 + 1]) + ay * ((1 - ax) * r1[x0] + ax * r1[x0 + 1]);
+    }
+
+    // I1 中以 (x,y) 为左上角的块，块完全在图像内时整块共用一组插值权重
+    void samplePatch(const cv::Mat& img, float x, float y, float* out) const
+    {
+        const int ps = options_.patch;
+        const int x0 = int(std::floor(x)), y0 = int(std::floor(y));
+        if (x0 < 0 || y0 < 0 || x0 + ps >= img.cols || y0 + ps >= img.rows)
+        {
+            for (int r = 0; r < ps; r++)
+                for (int c = 0; c < ps; c++)
+                    out[r * ps + c] = intensity(img, x + c, y + r);
+            return;
+        }
+        const float ax = x - x0, ay = y - y0;
+        const float w00 = (1 - ax) * (1 - ay), w01 = ax * (1 - ay), w10 = (1 - ax) * ay, w11 = ax * ay;
+        for (int r = 0; r < ps; r++)
+        {
+            const uchar* r0 = img.ptr<uchar>(y0 + r) + x0;
+            const uchar* r1 = img.ptr<uchar>(y0 + r + 1) + x0;
+            float* o = out + r * ps;
+            for (int c = 0; c < ps; c++)
+                o[c] = w00 * r0[c] + w01 * r0[c + 1] + w10 * r1[c] + w11 * r1[c + 1];
+        }
+    }
+
+    // 一个块的模板：去均值的灰度、梯度和 Hessian 的逆，线程内复用
+    struct Template
+    {
+        std::vector<float> T, TX, TY, W;
+        float mean_t = 0, ixx = 0, ixy = 0, iyy = 0;
+        bool textured = false;
+    };
+
+    void loadTemplate(const LKPyramid& from, int l, int px, int py, Template& t) const
+    {
+        const int ps = options_.patch, area = ps * ps;
+        t.T.resize(area);
+        t.TX.resize(area);
+        t.TY.resize(area);
+        t.W.resize(area);
+        float mean_t = 0, hxx = 0, hxy = 0, hyy = 0;
+        for (int r = 0; r < ps; r++)
+        {
+            const uchar* row = from.gray[l].ptr<uchar>(py + r) + px;
+            const float* gx = from.gx[l].ptr<float>(py + r) + px;
+            const float* gy = from.gy[l].ptr<float>(py + r) + px;
+            for (int c = 0; c < ps; c++)
+            {
+                const int i = r * ps + c;
+                t.T[i] = row[c];
+                t.TX[i] = gx[c];
+                t.TY[i] = gy[c];
+                mean_t += row[c];
+                hxx += gx[c] * gx[c];
+                hxy += gx[c] * gy[c];
+                hyy += gy[c] * gy[c];
+            }
+        }
+        t.mean_t = mean_t / area;
+        const float det = hxx * hyy - hxy * hxy;
+        t.textured = det >= 1e-3f * area * area;
+        if (t.textured)
+        {
+            t.ixx = hyy / det;
+            t.ixy = -hxy / det;
+            t.iyy = hxx / det;
+        }
+    }
+
+    // 块平移 (u,v) 后去均值的误差平方和；b 非空时同时给出 J^T e
+    float patchCost(const cv::Mat& I1, int px, int py, float u, float v, Template& t, float* b = nullptr) const
+    {
+        const int area = options_.patch * options_.patch;
+        samplePatch(I1, px + u, py + v, t.W.data());
+        float mean_w = 0;
+        for (int i = 0; i < area; i++)
+            mean_w += t.W[i];
+        const float offset = mean_w / area - t.mean_t;
+        float bx = 0, by = 0, cost = 0;
+        for (int i = 0; i < area; i++)
+        {
+            const float e = t.W[i] - t.T[i] - offset;
+            bx += t.TX[i] * e;
+            by += t.TY[i] * e;
+            cost += e * e;
+        }
+        if (b)
+        {
+            b[0] = bx;
+            b[1] = by;
+        }
+        return cost;
+    }
+
+    // 从 (u,v) 出发做逆向组合迭代，返回迭代过程中误差最小的位置及其误差；偏离出发点超过一个块时退回出发点
+    float optimize(const cv::Mat& I1, int px, int py, Template& t, float& u, float& v) const
+    {
+        const int ps = options_.patch;
+        const float u0 = u, v0 = v;
+        float b[2];
+        float best_cost = patchCost(I1, px, py, u, v, t, b), best_u = u, best_v = v;
+        if (!t.textured)
+            return best_cost;
+        for (int it = 0; it < options_.iterations; it++)
+        {
+            const float du = t.ixx * b[0] + t.ixy * b[1], dv = t.ixy * b[0] + t.iyy * b[1];
+            u -= du;
+            v -= dv;
+            const float cost = patchCost(I1, px, py, u, v, t, b);
+            if (cost < best_cost)
+            {
+                best_cost = cost;
+                best_u = u;
+                best_v = v;
+            }
+            if (du * du + dv * dv < options_.epsilon * options_.epsilon)
+                break;
+        }
+        if ((best_u - u0) * (best_u - u0) + (best_v - v0) * (best_v - v0) > float(ps * ps))
+        {
+            u = u0;
+            v = v0;
+            return patchCost(I1, px, py, u, v, t);
+        }
+        u = best_u;
+        v = best_v;
+        return best_cost;
+    }
+
+    // 第 l 层逐块逆向组合搜索，结果写入 patch_u_/patch_v_；has_prior 时初值取自 prior_
+    void patchSearch(const LKPyramid& from, const LKPyramid& to, int l, bool has_prior)
+    {
+        const cv::Mat& I1 = to.gray[l];
+        const int ps = options_.patch;
+        gridPositions(from.gray[l].cols, ps, options_.stride, xs_);
+        gridPositions(from.gray[l].rows, ps, options_.stride, ys_);
+        const int nx = xs_.size(), ny = ys_.size(), n = nx * ny;
+        patch_u_.resize(n);
+        patch_v_.resize(n);
+        patch_cost_.resize(n);
+
+#pragma omp parallel
+        {
+            Template t;
+#pragma omp for schedule(static)
+            for (int k = 0; k < n; k++)
+            {
+                const int px = xs_[k % nx], py = ys_[k / nx];
+                float u = 0, v = 0;
+                if (has_prior)
+                {
+                    // 上一层的光流在块中心处取值，放大两倍
+                    const float cx = (px + 0.5f * ps + 0.5f) * 0.5f - 0.5f;
+                    const float cy = (py + 0.5f * ps + 0.5f) * 0.5f - 0.5f;
+                    u = 2 * prior_.sample(prior_.u, cx, cy);
+                    v = 2 * prior_.sample(prior_.v, cx, cy);
+                }
+                loadTemplate(from, l, px, py, t);
+                patch_cost_[k] = optimize(I1, px, py, t, u, v);
+                patch_u_[k] = u;
+                patch_v_[k] = v;
+            }
+        }
+
+        // 空间传播：相邻块的光流误差更小时以它为初值重新迭代，纠正粗层传下来的错误初值；
+        // 每一轮只读上一轮的结果，块之间仍然相互独立
+        for (int pass = 0; pass < options_.propagation; pass++)
+        {
+            next_u_ = patch_u_;
+            next_v_ = patch_v_;
+            next_cost_ = patch_cost_;
+#pragma omp parallel
+            {
+                Template t;
+#pragma omp for schedule(static)
+                for (int k = 0; k < n; k++)
+                {
+                    const int i = k % nx, j = k / nx;
+                    const int px = xs_[i], py = ys_[j];
+                    const int neighbors[4] = { i > 0 ? k - 1 : -1, i + 1 < nx ? k + 1 : -1, j > 0 ? k - nx : -1, j + 1 < ny ? k + nx : -1 };
+                    bool loaded = false;
+                    float best_cost = patch_cost_[k], best_u = 0, best_v = 0;
+                    for (int m : neighbors)
+                    {
+                        // 与本块相差不到半个像素的候选，迭代后也会回到本块的结果
+                        if (m < 0)
+                            continue;
+                        const float du = patch_u_[m] - patch_u_[k], dv = patch_v_[m] - patch_v_[k];
+                        if (du * du + dv * dv < 0.25f)
+                            continue;
+                        if (!loaded)
+                        {
+                            loadTemplate(from, l, px, py, t);
+                            loaded = true;
+                        }
+                        const float cost = patchCost(I1, px, py, patch_u_[m], patch_v_[m], t);
+                        if (cost < best_cost)
+                        {
+                            best_cost = cost;
+                            best_u = patch_u_[m];
+                            best_v = patch_v_[m];
+                        }
+                    }
+                    if (best_cost >= patch_cost_[k])
+                        continue;
+                    next_cost_[k] = optimize(I1, px, py, t, best_u, best_v);
+                    next_u_[k] = best_u;
+                    next_v_[k] = best_v;
+                }
+            }
+            std::swap(patch_u_, next_u_);
+            std::swap(patch_v_, next_v_);
+            std::swap(patch_cost_, next_cost_);
+        }
+    }
+
+    // 覆盖每个像素的各块按该像素处的光度误差加权平均，权重为 1/max(1,|I1(x+u)-I0(x)|)
+    void densify(const cv::Mat& I0, const cv::Mat& I1)
+    {
+        const int ps = options_.patch, nx = xs_.size();
+        const int w = I0.cols, h = I0.rows;
+        coverRange(w, ps, xs_, col_first_, col_last_);
+        coverRange(h, ps, ys_, row_first_, row_last_);
+        field_.resize(w, h);
+#pragma omp parallel for schedule(static)
+        for (int y = 0; y < h; y++)
+        {
+            const uchar* row = I0.ptr<uchar>(y);
+            for (int x = 0; x < w; x++)
+            {
+                float sw = 0, su = 0, sv = 0;
+                for (int j = row_first_[y]; j <= row_last_[y]; j++)
+                    for (int i = col_first_[x]; i <= col_last_[x]; i++)
+                    {
+                        const int k = j * nx + i;
+                        const float u = patch_u_[k], v = patch_v_[k];
+                        const float d = std::fabs(intensity(I1, x + u, y + v) - row[x]);
+                        const float wt = 1.0f / std::max(1.0f, d);
+                        sw += wt;
+                        su += wt * u;
+                        sv += wt * v;
+                    }
+                field_.u[y * w + x] = sw > 0 ? su / sw : 0;
+                field_.v[y * w + x] = sw > 0 ? sv / sw : 0;
+            }
+        }
+    }
+
+    Options options_;
+    LKPyramid from_, to_;
+
+    // 每次调用复用的缓冲
+    Field field_, prior_;
+    std::vector<int> xs_, ys_, col_first_, col_last_, row_first_, row_last_;
+    std::vector<float> patch_u_, patch_v_, patch_cost_, next_u_, next_v_, next_cost_;
+};
+
+#endif // DIS_FLOW_H
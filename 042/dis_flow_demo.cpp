@@ -0,0 +1,218 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+using namespace std;
+
+#include "dis_flow.h"
+
+// 稠密光流示例：
+//   tum:    读取 associate.txt，计算相邻帧之间的光流，金字塔在相邻两次计算之间复用
+//   remode: 读取 REMODE 数据集，计算第一帧(参考帧)到其余各帧的光流，并用已知位姿检查对应点到极线的距离
+// 两种模式都输出光流前后的平均光度误差，并显示光流的颜色编码
+
+// 光流 I0(x) -> I1(x+u) 的平均灰度误差，u 为空时即不做对齐的误差
+double photometricError(const cv::Mat& I0, const cv::Mat& I1, const cv::Mat* flow)
+{
+    double sum = 0;
+    int count = 0;
+    for (int y = 0; y < I0.rows; y++)
+        for (int x = 0; x < I0.cols; x++)
+        {
+            float u = 0, v = 0;
+            if (flow)
+            {
+                u = flow->ptr<float>(y)[2 * x];
+                v = flow->ptr<float>(y)[2 * x + 1];
+            }
+            float fx = x + u, fy = y + v;
+            if (fx < 0 || fy < 0 || fx >= I1.cols - 1 || fy >= I1.rows - 1)
+                continue;
+            int x0 = int(fx), y0 = int(fy);
+            float ax = fx - x0, ay = fy - y0;
+            const uchar* r0 = I1.ptr<uchar>(y0);
+            const uchar* r1 = I1.ptr<uchar>(y0 + 1);
+            float value = (1 - ay) * ((1 - ax) * r0[x0] + ax * r0[x0 + 1]) + ay * ((1 - ax) * r1[x0] + ax * r1[x0 + 1]);
+            sum += fabs(value - I0.ptr<uchar>(y)[x]);
+            count++;
+        }
+    return count > 0 ? sum / count : 0;
+}
+
+// 颜色编码：色调表示方向，亮度表示大小
+void showFlow(const cv::Mat& flow, float max_magnitude)
+{
+    cv::Mat hsv(flow.rows, flow.cols, CV_8UC3), bgr;
+    for (int y = 0; y < flow.rows; y++)
+        for (int x = 0; x < flow.cols; x++)
+        {
+            float u = flow.ptr<float>(y)[2 * x], v = flow.ptr<float>(y)[2 * x + 1];
+            float angle = atan2(v, u) * 180 / M_PI;
+            uchar* p = hsv.ptr<uchar>(y) + 3 * x;
+            p[0] = uchar((angle < 0 ? angle + 360 : angle) / 2);
+            p[1] = 255;
+            p[2] = uchar(min(255.0f, 255 * sqrt(u * u + v * v) / max_magnitude));
+        }
+    cv::cvtColor(hsv, bgr, cv::COLOR_HSV2BGR);
+    cv::imshow("flow", bgr);
+    cv::waitKey(1);
+}
+
+void runTUM(const string& path, int num_frames)
+{
+    ifstream fin(path + "/associate.txt");
+    if (!fin)
+    {
+        cerr << "Cann't find associate.txt!" << endl;
+        return;
+    }
+    DISFlow::Options options;
+    DISFlow dis(options);
+    LKPyramid prev, curr;
+    string rgb_file, depth_file, time_rgb, time_depth;
+    cv::Mat color, gray, last_gray, flow;
+    double total_time = 0, total_before = 0, total_after = 0;
+    int pairs = 0;
+    for (int index = 0; index < num_frames && fin >> time_rgb >> rgb_file >> time_depth >> depth_file; index++)
+    {
+        color = cv::imread(path + "/" + rgb_file);
+        if (color.data == nullptr)
+            continue;
+        cv::cvtColor(color, gray, cv::COLOR_BGR2GRAY);
+
+        chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+        swap(prev, curr);
+        curr.build(gray, options.levels);
+        if (last_gray.empty())
+        {
+            last_gray = gray.clone();
+            continue;
+        }
+        dis.calc(prev, curr, flow);
+        chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+        double time_used = chrono::duration_cast<chrono::duration<double>>(t2 - t1).count();
+
+        double before = photometricError(last_gray, gray, nullptr);
+        double after = photometricError(last_gray, gray, &flow);
+        cout << "frame " << index << ": " << time_used * 1000 << " ms, photometric error " << before << " -> " << after << endl;
+        total_time += time_used;
+        total_before += before;
+        total_after += after;
+        pairs++;
+        showFlow(flow, 20);
+        last_gray = gray.clone();
+    }
+    if (pairs > 0)
+        cout << "average over " << pairs << " frame pairs: " << total_time / pairs * 1000 << " ms, photometric error "
+            << total_before / pairs << " -> " << total_after / pairs << endl;
+}
+
+void runREMODE(const string& path, int num_frames)
+{
+    // 数据格式：图像文件名 tx, ty, tz, qx, qy, qz, qw ，注意是 TWC 而非 TCW
+    ifstream fin(path + "../test_data/first_200_frames_traj_over_table_input_sequence.txt");
+    if (!fin)
+    {
+        cerr << "Cann't find the REMODE trajectory file!" << endl;
+        return;
+    }
+    vector<string> files;
+    vector<Eigen::Isometry3d, Eigen::aligned_allocator<Eigen::Isometry3d>> poses_TWC;
+    string image;
+    double data[7];
+    while (fin >> image >> data[0] >> data[1] >> data[2] >> data[3] >> data[4] >> data[5] >> data[6])
+    {
+        Eigen::Isometry3d T = Eigen::Isometry3d::Identity();
+        T.linear() = Eigen::Quaterniond(data[6], data[3], data[4], data[5]).normalized().toRotationMatrix();
+        T.translation() = Eigen::Vector3d(data[0], data[1], data[2]);
+        files.push_back(path + "/images/" + image);
+        poses_TWC.push_back(T);
+    }
+    if (files.size() < 2)
+        return;
+
+    // 相机内参，与 062 的 dense_mapping 相同
+    const double fx = 481.2, fy = -480.0, cx = 319.5, cy = 239.5;
+    Eigen::Matrix3d K;
+    K << fx, 0, cx, 0, fy, cy, 0, 0, 1;
+    const Eigen::Matrix3d K_inv = K.inverse();
+
+    DISFlow::Options options;
+    DISFlow dis(options);
+    LKPyramid ref_pyramid, curr_pyramid;
+    cv::Mat ref = cv::imread(files[0], 0), curr, flow;
+    if (ref.data == nullptr)
+        return;
+    ref_pyramid.build(ref, options.levels);
+
+    vector<double> distances;
+    for (int index = 1; index < min(num_frames, int(files.size())); index++)
+    {
+        curr = cv::imread(files[index], 0);
+        if (curr.data == nullptr)
+            continue;
+        chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+        curr_pyramid.build(curr, options.levels);
+        dis.calc(ref_pyramid, curr_pyramid, flow);
+        chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+        double time_used = chrono::duration_cast<chrono::duration<double>>(t2 - t1).count();
+
+        // 基础矩阵 F = K^-T [t]x R K^-1，对应点 x' 到极线 F x 的距离
+        Eigen::Isometry3d T_C_R = poses_TWC[index].inverse() * poses_TWC[0];
+        Eigen::Vector3d t = T_C_R.translation();
+        Eigen::Matrix3d t_hat;
+        t_hat << 0, -t[2], t[1], t[2], 0, -t[0], -t[1], t[0], 0;
+        Eigen::Matrix3d F = K_inv.transpose() * t_hat * T_C_R.rotation() * K_inv;
+        distances.clear();
+        for (int y = 0; y < ref.rows; y += 2)
+            for (int x = 0; x < ref.cols; x += 2)
+            {
+                const float* f = flow.ptr<float>(y) + 2 * x;
+                Eigen::Vector3d line = F * Eigen::Vector3d(x, y, 1);
+                double norm = sqrt(line[0] * line[0] + line[1] * line[1]);
+                if (norm < 1e-12)
+                    continue;
+                distances.push_back(fabs(line.dot(Eigen::Vector3d(x + f[0], y + f[1], 1))) / norm);
+            }
+        double median = 0;
+        if (!distances.empty())
+        {
+            nth_element(distances.begin(), distances.begin() + distances.size() / 2, distances.end());
+            median = distances[distances.size() / 2];
+        }
+        cout << "frame " << index << ": " << time_used * 1000 << " ms, photometric error "
+            << photometricError(ref, curr, nullptr) << " -> " << photometricError(ref, curr, &flow)
+            << ", median epipolar distance " << median << " px" << endl;
+        showFlow(flow, 40);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        cout << "usage: dis_flow_demo path_to_dataset tum|remode [num_frames]" << endl;
+        return 1;
+    }
+    string path = argv[1], mode = argv[2];
+    int num_frames = argc > 3 ? atoi(argv[3]) : 30;
+    if (mode == "tum")
+        runTUM(path, num_frames);
+    else if (mode == "remode")
+        runREMODE(path, num_frames);
+    else
+    {
+        cout << "unknown mode " << mode << endl;
+        return 1;
+    }
+    return 0;
+}
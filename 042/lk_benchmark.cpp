@@ -0,0 +1,150 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/features2d/features2d.hpp>
+#include <opencv2/video/tracking.hpp>
+
+using namespace std;
+
+#include "lk_tracker.h"
+
+// 在 TUM 序列的相邻帧上对比 cv::calcOpticalFlowPyrLK 与 LKTracker：
+// 每对相邻帧在前一帧上重新检测 FAST 角点，两种方法跟踪同一组点，比较耗时、成功点数和结果差异
+// OpenCV 同样做一次反向跟踪，两边使用相同的前后向阈值
+
+double seconds(chrono::steady_clock::time_point t1, chrono::steady_clock::time_point t2)
+{
+    return chrono::duration_cast<chrono::duration<double>>(t2 - t1).count();
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        cout << "usage: lk_benchmark path_to_dataset [num_frames] [max_points]" << endl;
+        return 1;
+    }
+    string path_to_dataset = argv[1];
+    int num_frames = argc > 2 ? atoi(argv[2]) : 100;
+    int max_points = argc > 3 ? atoi(argv[3]) : 1000;
+    ifstream fin(path_to_dataset + "/associate.txt");
+    if (!fin)
+    {
+        cerr << "Cann't find associate.txt!" << endl;
+        return 1;
+    }
+
+    LKTracker::Options options;
+    LKTracker tracker(options);
+    cv::Ptr<cv::FastFeatureDetector> detector = cv::FastFeatureDetector::create();
+    const cv::Size window(options.patch + 1, options.patch + 1);
+    const int max_level = options.levels - 1;
+
+    string rgb_file, depth_file, time_rgb, time_depth;
+    cv::Mat color, gray, last_gray;
+    double time_cv = 0, time_cv_fb = 0, time_lk = 0, sum_diff = 0;
+    long tracked_cv = 0, tracked_lk = 0, total = 0, both = 0, far = 0;
+    int pairs = 0;
+
+    for (int index = 0; index < num_frames; index++)
+    {
+        fin >> time_rgb >> rgb_file >> time_depth >> depth_file;
+        if (!fin)
+            break;
+        color = cv::imread(path_to_dataset + "/" + rgb_file);
+        if (color.data == nullptr)
+            continue;
+        cv::cvtColor(color, gray, cv::COLOR_BGR2GRAY);
+
+        chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+        tracker.addFrame(gray);
+        chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+        if (last_gray.empty())
+        {
+            last_gray = gray.clone();
+            continue;
+        }
+
+        // 在上一帧检测角点，保留响应最强的 max_points 个
+        vector<cv::KeyPoint> kps;
+        detector->detect(last_gray, kps);
+        sort(kps.begin(), kps.end(), [](const cv::KeyPoint& a, const cv::KeyPoint& b) { return a.response > b.response; });
+        if (int(kps.size()) > max_points)
+            kps.resize(max_points);
+        vector<cv::Point2f> prev_points;
+        FlowPoints points;
+        for (const cv::KeyPoint& kp : kps)
+        {
+            prev_points.push_back(kp.pt);
+            points.push_back(kp.pt.x, kp.pt.y);
+        }
+
+        // OpenCV：前向，再反向检查
+        vector<cv::Point2f> next_points, back_points;
+        vector<uchar> status, back_status;
+        vector<float> error;
+        chrono::steady_clock::time_point t3 = chrono::steady_clock::now();
+        cv::calcOpticalFlowPyrLK(last_gray, gray, prev_points, next_points, status, error, window, max_level);
+        chrono::steady_clock::time_point t4 = chrono::steady_clock::now();
+        cv::calcOpticalFlowPyrLK(gray, last_gray, next_points, back_points, back_status, error, window, max_level);
+        chrono::steady_clock::time_point t5 = chrono::steady_clock::now();
+        for (size_t i = 0; i < status.size(); i++)
+        {
+            float dx = back_points[i].x - prev_points[i].x, dy = back_points[i].y - prev_points[i].y;
+            if (!back_status[i] || dx * dx + dy * dy > options.fb_threshold * options.fb_threshold)
+                status[i] = 0;
+        }
+
+        // LKTracker：上一帧的金字塔已在上一轮建好，本帧只建一次
+        chrono::steady_clock::time_point t6 = chrono::steady_clock::now();
+        tracker.track(points);
+        chrono::steady_clock::time_point t7 = chrono::steady_clock::now();
+
+        double dt_cv = seconds(t3, t4), dt_cv_fb = seconds(t3, t5), dt_lk = seconds(t1, t2) + seconds(t6, t7);
+        int n_cv = 0, n_lk = 0, n_both = 0;
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            n_cv += status[i];
+            n_lk += points.status[i];
+            if (!status[i] || !points.status[i])
+                continue;
+            double d = hypot(points.x[i] - next_points[i].x, points.y[i] - next_points[i].y);
+            sum_diff += d;
+            if (d > 1.0)
+                far++;
+            n_both++;
+        }
+        cout << "frame " << index << ": " << points.size() << " points | opencv " << dt_cv * 1000 << " ms, with check "
+            << dt_cv_fb * 1000 << " ms, " << n_cv << " tracked | LKTracker " << dt_lk * 1000 << " ms, "
+            << n_lk << " tracked" << endl;
+
+        time_cv += dt_cv;
+        time_cv_fb += dt_cv_fb;
+        time_lk += dt_lk;
+        tracked_cv += n_cv;
+        tracked_lk += n_lk;
+        total += points.size();
+        both += n_both;
+        pairs++;
+        last_gray = gray.clone();
+    }
+
+    if (pairs > 0 && total > 0)
+    {
+        cout << "average over " << pairs << " frame pairs:" << endl;
+        cout << "  opencv: " << time_cv / pairs * 1000 << " ms forward, " << time_cv_fb / pairs * 1000
+            << " ms with forward-backward check, " << 100.0 * tracked_cv / total << "% tracked" << endl;
+        cout << "  LKTracker: " << time_lk / pairs * 1000 << " ms including pyramid, "
+            << 100.0 * tracked_lk / total << "% tracked, speedup " << time_cv_fb / time_lk << "x" << endl;
+        if (both > 0)
+            cout << "  points tracked by both: mean difference " << sum_diff / both << " px, "
+                << 100.0 * far / both << "% differ by more than 1 px" << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,378 @@
+#ifndef LK_TRACKER_H
+#define LK_TRACKER_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// 金字塔 LK 光流：只估计平移，逆向组合 (inverse compositional) 形式，
+// 模板块的梯度和 2x2 Hessian 每层只算一次，迭代时只需采样当前帧的块
+// 平移模型下整个块的亚像素权重相同，一行 8 个像素可以用 AVX2 一次完成双线性插值
+// 各点之间相互独立，用 OpenMP 并行；前后向跟踪结果不一致的点判为失败
+
+// 按分量连续存放的点集，跟踪后用 compact() 去掉失败的点
+struct FlowPoints
+{
+    std::vector<float> x, y;
+    std::vector<uchar> status;   // track() 的结果，1 为成功
+    std::vector<int> id;         // 轨迹编号，不需要时为 -1
+    std::vector<int> age;        // 已连续跟踪的帧数
+
+    size_t size() const { return x.size(); }
+    void clear() { x.clear(); y.clear(); status.clear(); id.clear(); age.clear(); }
+    void push_back(float px, float py, int pid = -1)
+    {
+        x.push_back(px);
+        y.push_back(py);
+        status.push_back(1);
+        id.push_back(pid);
+        age.push_back(0);
+    }
+
+    // 把 status 为 1 的点按原顺序移到前面并截断，返回剩余的点数
+    int compact()
+    {
+        int n = 0;
+        for (size_t i = 0; i < x.size(); i++)
+        {
+            if (!status[i])
+                continue;
+            x[n] = x[i];
+            y[n] = y[i];
+            status[n] = 1;
+            id[n] = id[i];
+            age[n] = age[i];
+            n++;
+        }
+        x.resize(n);
+        y.resize(n);
+        status.resize(n);
+        id.resize(n);
+        age.resize(n);
+        return n;
+    }
+};
+
+// 一帧的灰度金字塔及各层的中心差分梯度
+struct LKPyramid
+{
+    std::vector<cv::Mat> gray;       // CV_8UC1
+    std::vector<cv::Mat> gx, gy;     // CV_32FC1
+
+    // 重复使用已分配的内存，尺寸不变时不重新分配
+    void build(const cv::Mat& image, int levels)
+    {
+        gray.resize(levels);
+        gx.resize(levels);
+        gy.resize(levels);
+        image.copyTo(gray[0]);
+        for (int l = 1; l < levels; l++)
+            cv::pyrDown(gray[l - 1], gray[l]);
+        for (int l = 0; l < levels; l++)
+            computeGradient(gray[l], gx[l], gy[l]);
+    }
+
+    static void computeGradient(const cv::Mat& img, cv::Mat& gx, cv::Mat& gy)
+    {
+        gx.create(img.rows, img.cols, CV_32FC1);
+        gy.create(img.rows, img.cols, CV_32FC1);
+        gx.setTo(0);
+        gy.setTo(0);
+#pragma omp parallel for schedule(static)
+        for (int y = 1; y < img.rows - 1; y++)
+        {
+            const uchar* up = img.ptr<uchar>(y - 1);
+            const uchar* row = img.ptr<uchar>(y);
+            const uchar* down = img.ptr<uchar>(y + 1);
+            float* px = gx.ptr<float>(y);
+            float* py = gy.ptr<float>(y);
+            for (int x = 1; x < img.cols - 1; x++)
+            {
+                px[x] = 0.5f * (float(row[x + 1]) - float(row[x - 1]));
+                py[x] = 0.5f * (float(down[x]) - float(up[x]));
+            }
+        }
+    }
+};
+
+class LKTracker
+{
+public:
+    static const int MAX_PATCH = 32;
+
+    struct Options
+    {
+        int levels;             // 金字塔层数
+        int patch;              // 块边长，不超过 MAX_PATCH，取 8 的倍数时全部由 AVX2 处理
+        int iterations;         // 每层最大迭代次数
+        float epsilon;          // 更新量小于此值(像素)时停止
+        float min_eigen;        // 模板 Hessian 最小特征值除以像素数的下限，太小说明纹理不足
+        float max_error;        // 收敛后平均灰度误差的上限
+        float fb_threshold;     // 前后向跟踪的位置差上限(像素)，小于等于 0 时不检查
+
+        Options() : levels(4), patch(16), iterations(30), epsilon(0.01f), min_eigen(1.0f),
+            max_error(10.0f), fb_threshold(0.5f) {}
+    };
+
+    LKTracker(const Options& options = Options()) : options_(options) {}
+
+    // 加入新的一帧，上一帧的金字塔保留为跟踪的起点
+    void addFrame(const cv::Mat& gray)
+    {
+        std::swap(prev_, curr_);
+        curr_.build(gray, options_.levels);
+        frames_++;
+    }
+
+    // 把 points 从上一帧跟踪到当前帧，原地写入新位置和 status
+    void track(FlowPoints& points) const
+    {
+        const int n = points.size();
+        points.status.assign(n, 0);
+        if (frames_ < 2)
+            return;
+#pragma omp parallel for schedule(dynamic, 16)
+        for (int i = 0; i < n; i++)
+        {
+            float x = points.x[i], y = points.y[i];
+            float nx = x, ny = y;
+            if (!trackPoint(prev_, curr_, x, y, nx, ny))
+                continue;
+            if (options_.fb_threshold > 0)
+            {
+                // 从跟踪结果出发反向跟踪回上一帧，应回到出发点；初值不用出发点，避免偏向通过检查
+                float bx = nx, by = ny;
+                if (!trackPoint(curr_, prev_, nx, ny, bx, by))
+                    continue;
+                if ((bx - x) * (bx - x) + (by - y) * (by - y) > options_.fb_threshold * options_.fb_threshold)
+                    continue;
+            }
+            points.x[i] = nx;
+            points.y[i] = ny;
+            points.status[i] = 1;
+        }
+    }
+
+private:
+    // 单个点由粗到精跟踪：from 中 (x,y) 处的块在 to 中的位置，(nx,ny) 为初值和结果
+    bool trackPoint(const LKPyramid& from, const LKPyramid& to, float x, float y, float& nx, float& ny) const
+    {
+        const int patch = options_.patch;
+        const int area = patch * patch;
+        const float half = 0.5f * (patch - 1);
+        float T[MAX_PATCH * MAX_PATCH], GX[MAX_PATCH * MAX_PATCH], GY[MAX_PATCH * MAX_PATCH];
+
+        // 初值的位移在各层间保持，最粗层从 (nx,ny)-(x,y) 开始
+        float dx = (nx - x) / (1 << (options_.levels - 1));
+        float dy = (ny - y) / (1 << (options_.levels - 1));
+        float error = 0;
+        for (int l = options_.levels - 1; l >= 0; l--)
+        {
+            if (l != options_.levels - 1)
+            {
+                dx *= 2;
+                dy *= 2;
+            }
+            const float scale = 1.0f / (1 << l);
+            const float dx0 = dx, dy0 = dy;
+            // 块的左上角
+            const float tx = x * scale - half, ty = y * scale - half;
+            const cv::Mat& tmpl = from.gray[l];
+            const cv::Mat& img = to.gray[l];
+            if (!fits(tmpl, tx, ty))
+            {
+                // 模板块不完全在图内：最底层判为失败，其余层跳过
+                if (l == 0) return false;
+                continue;
+            }
+
+            // 模板与梯度，Hessian 只算一次
+            sample(tmpl, tx, ty, T);
+            sample(from.gx[l], tx, ty, GX);
+            sample(from.gy[l], tx, ty, GY);
+            double hxx = 0, hxy = 0, hyy = 0;
+            for (int k = 0; k < area; k++)
+            {
+                hxx += GX[k] * GX[k];
+                hxy += GX[k] * GY[k];
+                hyy += GY[k] * GY[k];
+            }
+            double det = hxx * hyy - hxy * hxy;
+            double min_eigen = 0.5 * (hxx + hyy - std::sqrt((hxx - hyy) * (hxx - hyy) + 4 * hxy * hxy));
+            if (min_eigen < options_.min_eigen * area || det <= 0)
+            {
+                if (l == 0) return false;
+                continue;
+            }
+
+            bool inside = true;
+            for (int it = 0; it < options_.iterations; it++)
+            {
+                const float cx = tx + dx, cy = ty + dy;
+                if (!fits(img, cx, cy))
+                {
+                    inside = false;
+                    break;
+                }
+                float bx, by;
+                error = residual(img, cx, cy, T, GX, GY, bx, by);
+                // 逆向组合：模板上解出的增量取反作用在当前位置上
+                float ux = float((hyy * bx - hxy * by) / det);
+                float uy = float((hxx * by - hxy * bx) / det);
+                dx -= ux;
+                dy -= uy;
+                if (ux * ux + uy * uy < options_.epsilon * options_.epsilon)
+                    break;
+            }
+            if (!inside)
+            {
+                if (l == 0) return false;
+                // 粗层越界时退回到本层的初值，交给更细的层
+                dx = dx0;
+                dy = dy0;
+            }
+        }
+        if (error > options_.max_error)
+            return false;
+        nx = x + dx;
+        ny = y + dy;
+        return true;
+    }
+
+    // 左上角为 (x,y) 的块及右下相邻一行一列都在图内
+    inline bool fits(const cv::Mat& img, float x, float y) const
+    {
+        return x >= 0 && y >= 0 && x + options_.patch + 1 < img.cols && y + options_.patch + 1 < img.rows;
+    }
+
+    // 双线性采样左上角为 (x,y) 的块，块内各像素的插值权重相同
+    void sample(const cv::Mat& img, float x, float y, float* out) const
+    {
+        const int patch = options_.patch;
+        const int x0 = int(x), y0 = int(y);
+        const float fu = x - x0, fv = y - y0;
+        const float w00 = (1 - fu) * (1 - fv), w01 = fu * (1 - fv), w10 = (1 - fu) * fv, w11 = fu * fv;
+        for (int r = 0; r < patch; r++)
+        {
+            float* o = out + r * patch;
+            if (img.depth() == CV_8U)
+            {
+                const uchar* p0 = img.ptr<uchar>(y0 + r) + x0;
+                const uchar* p1 = img.ptr<uchar>(y0 + r + 1) + x0;
+                int c = 0;
+#ifdef __AVX2__
+                const __m256 v00 = _mm256_set1_ps(w00), v01 = _mm256_set1_ps(w01);
+                const __m256 v10 = _mm256_set1_ps(w10), v11 = _mm256_set1_ps(w11);
+                for (; c + 8 <= patch; c += 8)
+                    _mm256_storeu_ps(o + c, bilinear8(p0 + c, p1 + c, v00, v01, v10, v11));
+#endif
+                for (; c < patch; c++)
+                    o[c] = w00 * p0[c] + w01 * p0[c + 1] + w10 * p1[c] + w11 * p1[c + 1];
+            }
+            else
+            {
+                const float* p0 = img.ptr<float>(y0 + r) + x0;
+                const float* p1 = img.ptr<float>(y0 + r + 1) + x0;
+                int c = 0;
+#ifdef __AVX2__
+                const __m256 v00 = _mm256_set1_ps(w00), v01 = _mm256_set1_ps(w01);
+                const __m256 v10 = _mm256_set1_ps(w10), v11 = _mm256_set1_ps(w11);
+                for (; c + 8 <= patch; c += 8)
+                {
+                    __m256 s = _mm256_mul_ps(v00, _mm256_loadu_ps(p0 + c));
+                    s = _mm256_fmadd_ps(v01, _mm256_loadu_ps(p0 + c + 1), s);
+                    s = _mm256_fmadd_ps(v10, _mm256_loadu_ps(p1 + c), s);
+                    s = _mm256_fmadd_ps(v11, _mm256_loadu_ps(p1 + c + 1), s);
+                    _mm256_storeu_ps(o + c, s);
+                }
+#endif
+                for (; c < patch; c++)
+                    o[c] = w00 * p0[c] + w01 * p0[c + 1] + w10 * p1[c] + w11 * p1[c + 1];
+            }
+        }
+    }
+
+    // 采样当前帧的块并与模板比较，返回平均绝对误差，(bx,by) 为 J^T*e
+    float residual(const cv::Mat& img, float x, float y, const float* T, const float* GX, const float* GY,
+        float& bx, float& by) const
+    {
+        const int patch = options_.patch;
+        const int x0 = int(x), y0 = int(y);
+        const float fu = x - x0, fv = y - y0;
+        const float w00 = (1 - fu) * (1 - fv), w01 = fu * (1 - fv), w10 = (1 - fu) * fv, w11 = fu * fv;
+        float sx = 0, sy = 0, se = 0;
+        int c0 = 0;
+#ifdef __AVX2__
+        const __m256 v00 = _mm256_set1_ps(w00), v01 = _mm256_set1_ps(w01);
+        const __m256 v10 = _mm256_set1_ps(w10), v11 = _mm256_set1_ps(w11);
+        const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+        __m256 ax = _mm256_setzero_ps(), ay = _mm256_setzero_ps(), ae = _mm256_setzero_ps();
+        c0 = patch & ~7;
+        for (int r = 0; r < patch; r++)
+        {
+            const uchar* p0 = img.ptr<uchar>(y0 + r) + x0;
+            const uchar* p1 = img.ptr<uchar>(y0 + r + 1) + x0;
+            const int k = r * patch;
+            for (int c = 0; c < c0; c += 8)
+            {
+                __m256 e = _mm256_sub_ps(bilinear8(p0 + c, p1 + c, v00, v01, v10, v11), _mm256_loadu_ps(T + k + c));
+                ax = _mm256_fmadd_ps(_mm256_loadu_ps(GX + k + c), e, ax);
+                ay = _mm256_fmadd_ps(_mm256_loadu_ps(GY + k + c), e, ay);
+                ae = _mm256_add_ps(ae, _mm256_andnot_ps(sign_mask, e));
+            }
+        }
+        sx = hsum(ax);
+        sy = hsum(ay);
+        se = hsum(ae);
+#endif
+        for (int r = 0; r < patch; r++)
+        {
+            const uchar* p0 = img.ptr<uchar>(y0 + r) + x0;
+            const uchar* p1 = img.ptr<uchar>(y0 + r + 1) + x0;
+            const int k = r * patch;
+            for (int c = c0; c < patch; c++)
+            {
+                float e = w00 * p0[c] + w01 * p0[c + 1] + w10 * p1[c] + w11 * p1[c + 1] - T[k + c];
+                sx += GX[k + c] * e;
+                sy += GY[k + c] * e;
+                se += std::fabs(e);
+            }
+        }
+        bx = sx;
+        by = sy;
+        return se / (patch * patch);
+    }
+
+#ifdef __AVX2__
+    // 一行 8 个像素的双线性插值，p0/p1 为上下两行的起点
+    static inline __m256 bilinear8(const uchar* p0, const uchar* p1, __m256 w00, __m256 w01, __m256 w10, __m256 w11)
+    {
+        __m256 a = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p0))));
+        __m256 b = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p0 + 1))));
+        __m256 c = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p1))));
+        __m256 d = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p1 + 1))));
+        return _mm256_fmadd_ps(w00, a, _mm256_fmadd_ps(w01, b, _mm256_fmadd_ps(w10, c, _mm256_mul_ps(w11, d))));
+    }
+
+    static inline float hsum(__m256 v)
+    {
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        s = _mm_add_ss(s, _mm_movehdup_ps(s));
+        return _mm_cvtss_f32(s);
+    }
+#endif
+
+    Options options_;
+    LKPyramid prev_, curr_;
+    int frames_ = 0;
+};
+
+#endif // LK_TRACKER_H
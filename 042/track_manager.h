@@ -0,0 +1,142 @@
+#ifndef TRACK_MANAGER_H
+#define TRACK_MANAGER_H
+
+#include <vector>
+#include <algorithm>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/features2d/features2d.hpp>
+
+#include "lk_tracker.h"
+
+// 特征轨迹管理：图像分成固定大小的格子，每个格子保持目标数量的轨迹
+// 每帧先用 LKTracker 跟踪已有轨迹，过密格子里多余的轨迹按年龄从小到大去掉，
+// 再只在点数不足的格子里检测 FAST，已有轨迹周围一定半径内不取新点
+// 这样每帧跟踪的点数和检测的面积都有上限，不会随时间漂移
+class TrackManager
+{
+public:
+    struct Options
+    {
+        int cell_size;          // 格子边长(像素)
+        int per_cell;           // 每个格子的目标轨迹数
+        int fast_threshold;     // FAST 阈值
+        int min_distance;       // 新点与已有轨迹的最小距离(像素)
+        LKTracker::Options lk;
+
+        Options() : cell_size(48), per_cell(4), fast_threshold(20), min_distance(10) {}
+    };
+
+    TrackManager(const Options& options = Options()) : options_(options), tracker_(options.lk) {}
+
+    // 处理新的一帧：跟踪、裁剪过密的格子、在不足的格子里补点
+    void update(const cv::Mat& gray)
+    {
+        grid_cols_ = (gray.cols + options_.cell_size - 1) / options_.cell_size;
+        grid_rows_ = (gray.rows + options_.cell_size - 1) / options_.cell_size;
+        tracker_.addFrame(gray);
+        tracker_.track(tracks_);
+        tracks_.compact();
+        for (size_t i = 0; i < tracks_.size(); i++)
+            tracks_.age[i]++;
+        num_tracked_ = tracks_.size();
+        prune();
+        replenish(gray);
+    }
+
+    const FlowPoints& tracks() const { return tracks_; }
+    int numTracked() const { return num_tracked_; }       // 本帧跟踪成功的轨迹数
+    int numNew() const { return num_new_; }               // 本帧新建的轨迹数
+    int numDetectCells() const { return num_cells_; }     // 本帧做了检测的格子数
+
+private:
+    inline int cellIndex(float x, float y) const
+    {
+        int cx = std::min(std::max(int(x) / options_.cell_size, 0), grid_cols_ - 1);
+        int cy = std::min(std::max(int(y) / options_.cell_size, 0), grid_rows_ - 1);
+        return cy * grid_cols_ + cx;
+    }
+
+    // 每个格子只保留最老的 per_cell 条轨迹，点因运动聚到一起时不会越积越多
+    void prune()
+    {
+        const int n = tracks_.size();
+        order_.resize(n);
+        for (int i = 0; i < n; i++)
+            order_[i] = i;
+        std::stable_sort(order_.begin(), order_.end(), [this](int a, int b) { return tracks_.age[a] > tracks_.age[b]; });
+        counts_.assign(grid_cols_ * grid_rows_, 0);
+        for (int i : order_)
+        {
+            int& count = counts_[cellIndex(tracks_.x[i], tracks_.y[i])];
+            if (count < options_.per_cell)
+                count++;
+            else
+                tracks_.status[i] = 0;
+        }
+        tracks_.compact();
+    }
+
+    // 在点数不足的格子里检测 FAST，按响应从大到小补到目标数量；counts_ 来自 prune()
+    void replenish(const cv::Mat& gray)
+    {
+        const int radius = options_.min_distance;
+        mask_.create(gray.rows, gray.cols, CV_8UC1);
+        mask_.setTo(cv::Scalar(255));
+        for (size_t i = 0; i < tracks_.size(); i++)
+            cv::circle(mask_, cv::Point2f(tracks_.x[i], tracks_.y[i]), radius, cv::Scalar(0), -1);
+
+        // 离边界太近的点模板块放不下，跟踪必然失败，不取
+        const int border = options_.lk.patch / 2 + 1;
+        num_new_ = 0;
+        num_cells_ = 0;
+        for (int cy = 0; cy < grid_rows_; cy++)
+            for (int cx = 0; cx < grid_cols_; cx++)
+            {
+                int& count = counts_[cy * grid_cols_ + cx];
+                if (count >= options_.per_cell)
+                    continue;
+                num_cells_++;
+                const int x0 = std::max(cx * options_.cell_size, border);
+                const int y0 = std::max(cy * options_.cell_size, border);
+                const int x1 = std::min((cx + 1) * options_.cell_size, gray.cols - border);
+                const int y1 = std::min((cy + 1) * options_.cell_size, gray.rows - border);
+                if (x1 <= x0 || y1 <= y0)
+                    continue;
+
+                // FAST 需要 3 像素的圆，检测区域向外扩 3 像素，结果只保留格子内的点
+                const int ex0 = std::max(x0 - 3, 0), ey0 = std::max(y0 - 3, 0);
+                const int ex1 = std::min(x1 + 3, gray.cols), ey1 = std::min(y1 + 3, gray.rows);
+                cv::FAST(gray(cv::Rect(ex0, ey0, ex1 - ex0, ey1 - ey0)), keypoints_, options_.fast_threshold, true);
+                std::sort(keypoints_.begin(), keypoints_.end(),
+                    [](const cv::KeyPoint& a, const cv::KeyPoint& b) { return a.response > b.response; });
+                for (const cv::KeyPoint& kp : keypoints_)
+                {
+                    if (count >= options_.per_cell)
+                        break;
+                    const float x = kp.pt.x + ex0, y = kp.pt.y + ey0;
+                    if (x < x0 || x >= x1 || y < y0 || y >= y1 || mask_.at<uchar>(int(y), int(x)) == 0)
+                        continue;
+                    tracks_.push_back(x, y, next_id_++);
+                    cv::circle(mask_, cv::Point2f(x, y), radius, cv::Scalar(0), -1);
+                    count++;
+                    num_new_++;
+                }
+            }
+    }
+
+    Options options_;
+    LKTracker tracker_;
+    FlowPoints tracks_;
+    int next_id_ = 0;
+    int grid_cols_ = 0, grid_rows_ = 0;
+    int num_tracked_ = 0, num_new_ = 0, num_cells_ = 0;
+
+    // 每帧复用的缓冲
+    cv::Mat mask_;
+    std::vector<int> counts_, order_;
+    std::vector<cv::KeyPoint> keypoints_;
+};
+
+#endif // TRACK_MANAGER_H
@@ -0,0 +1,221 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <string>
+#include <algorithm>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "direct_tracker.h"
+#include "direct_tracker_ic.h"
+#include "pixel_selector.h"
+
+using namespace std;
+
+// 离线批处理：读入整个序列，按段处理，每段的第一帧是关键帧，
+// 段内其余各帧都只对齐到该关键帧，彼此独立，由 OpenMP 线程池并行对齐；
+// 段内最后一个对齐成功的帧作为下一段的关键帧。没有界面，结果写成 TUM 格式轨迹
+
+struct FrameEntry
+{
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    string timestamp;
+    string rgb_file, depth_file;
+    bool aligned = false;
+    Eigen::Isometry3d Tcw = Eigen::Isometry3d::Identity();
+};
+
+// 按比例 a 缩放相对运动 T：旋转角和平移都乘以 a，作为匀速模型下的初值
+Eigen::Isometry3d scaleMotion ( const Eigen::Isometry3d& T, double a )
+{
+    Eigen::AngleAxisd rotation ( T.rotation() );
+    Eigen::Isometry3d S = Eigen::Isometry3d::Identity();
+    S.linear() = Eigen::AngleAxisd ( rotation.angle() *a, rotation.axis() ).toRotationMatrix();
+    S.translation() = T.translation() *a;
+    return S;
+}
+
+// 读取灰度图，失败时返回空图
+cv::Mat loadGray ( const string& file )
+{
+    cv::Mat color = cv::imread ( file ), gray;
+    if ( color.data==nullptr )
+        return gray;
+    cv::cvtColor ( color, gray, cv::COLOR_BGR2GRAY );
+    return gray;
+}
+
+int main ( int argc, char** argv )
+{
+    if ( argc < 2 )
+    {
+        cout<<"usage: direct_batch path_to_dataset [trajectory_file] [segment_length]"<<endl;
+        return 1;
+    }
+    string path_to_dataset = argv[1];
+    string trajectory_file = argc > 2 ? argv[2] : "trajectory.txt";
+    int segment_length = argc > 3 ? max ( 1, atoi ( argv[3] ) ) : 10;
+
+    ifstream fin ( path_to_dataset + "/associate.txt" );
+    if ( !fin )
+    {
+        cout<<"please generate the associate file called associate.txt!"<<endl;
+        return 1;
+    }
+
+    // 相机内参
+    float cx = 325.5;
+    float cy = 253.5;
+    float fx = 518.0;
+    float fy = 519.0;
+    float depth_scale = 1000.0;
+
+    // 对齐后有效点比例低于此值的帧不作为关键帧
+    const double keyframe_valid_ratio = 0.5;
+
+    // 先读入整个序列的文件列表
+    vector<FrameEntry, Eigen::aligned_allocator<FrameEntry>> frames;
+    string time_rgb, time_depth;
+    FrameEntry entry;
+    while ( fin>>time_rgb>>entry.rgb_file>>time_depth>>entry.depth_file )
+    {
+        entry.timestamp = time_rgb;
+        entry.rgb_file = path_to_dataset+"/"+entry.rgb_file;
+        entry.depth_file = path_to_dataset+"/"+entry.depth_file;
+        frames.push_back ( entry );
+    }
+    const int n = frames.size();
+
+    // 并行度来自帧之间，跟踪器内部的 OpenMP 并行区域只用一个线程
+#ifdef _OPENMP
+    omp_set_max_active_levels ( 1 );
+    int num_threads = omp_get_max_threads();
+#else
+    int num_threads = 1;
+#endif
+    cout<<"read "<<n<<" frames, aligning with "<<num_threads<<" threads, segment length "<<segment_length<<endl;
+
+    PixelSelector selector ( fx, fy, cx, cy, depth_scale );
+    InverseCompositionalTracker reference_tracker ( fx, fy, cx, cy );
+    PointBuffer points;
+    int keyframes = 0, failed = 0;
+    double time_reference = 0;
+
+    chrono::steady_clock::time_point t_start = chrono::steady_clock::now();
+    int kf = 0, prev_kf = -1;
+    Eigen::Isometry3d T_prev_w = Eigen::Isometry3d::Identity();    // 上一个关键帧的位姿
+    while ( kf < n )
+    {
+        // 关键帧：选点并预计算参考数据，点和位姿都在关键帧坐标系下
+        chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+        cv::Mat gray = loadGray ( frames[kf].rgb_file );
+        cv::Mat depth = cv::imread ( frames[kf].depth_file, -1 );
+        if ( gray.data==nullptr || depth.data==nullptr )
+        {
+            if ( kf > 0 ) failed++;
+            if ( kf+1 < n )
+                frames[kf+1].Tcw = frames[kf].Tcw;
+            frames[kf].aligned = false;
+            kf++;
+            continue;
+        }
+        if ( kf == 0 )
+            frames[kf].aligned = true;
+        selector.select ( gray, depth, points );
+        reference_tracker.setReference ( points, gray, Eigen::Isometry3d::Identity() );
+        const Eigen::Isometry3d T_kf_w = frames[kf].Tcw;
+        const int ref_points = points.size();
+        // 上一段的平均每帧运动，作为段内第一帧的初值
+        const Eigen::Isometry3d T_kf_prev = T_kf_w * T_prev_w.inverse();
+        const int prev_span = prev_kf >= 0 ? kf-prev_kf : 0;
+        keyframes++;
+        chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+        time_reference += chrono::duration_cast<chrono::duration<double>> ( t2-t1 ).count();
+
+        // 段内第一帧先单独对齐，得到本段的每帧运动；其余各帧按距关键帧的帧数外推初值后并行对齐，
+        // 每个线程复制一份已预计算好的跟踪器
+        const int end = min ( n, kf+1+segment_length );
+        if ( end == kf+1 )
+            break;
+        vector<int> valid ( end-kf, 0 );
+        Eigen::Isometry3d T_step = prev_span > 0 ? scaleMotion ( T_kf_prev, 1.0/prev_span ) : Eigen::Isometry3d::Identity();
+        auto align = [&] ( InverseCompositionalTracker& tracker, int i )
+        {
+            frames[i].aligned = false;
+            cv::Mat gray_i = loadGray ( frames[i].rgb_file );
+            if ( gray_i.data==nullptr )
+                return;
+            Eigen::Isometry3d T_cur_kf = scaleMotion ( T_step, i-kf );
+            if ( !tracker.track ( gray_i, T_cur_kf ) )
+                return;
+            frames[i].Tcw = T_cur_kf * T_kf_w;
+            frames[i].aligned = true;
+            valid[i-kf] = tracker.numValid();
+        };
+        {
+            InverseCompositionalTracker tracker = reference_tracker;
+            align ( tracker, kf+1 );
+            if ( frames[kf+1].aligned )
+                T_step = frames[kf+1].Tcw * T_kf_w.inverse();
+        }
+        #pragma omp parallel
+        {
+            InverseCompositionalTracker tracker = reference_tracker;
+            #pragma omp for schedule(dynamic)
+            for ( int i=kf+2; i<end; i++ )
+                align ( tracker, i );
+        }
+
+        // 下一个关键帧取段内最靠后且有效点足够的帧，它之后的帧在下一段重新对齐
+        int next = kf;
+        for ( int i=end-1; i>kf; i-- )
+            if ( frames[i].aligned && valid[i-kf] >= keyframe_valid_ratio * ref_points )
+            {
+                next = i;
+                break;
+            }
+        for ( int i=kf+1; i<next; i++ )
+            if ( !frames[i].aligned )
+                failed++;
+        if ( next == kf )
+        {
+            // 整段都没有可靠的帧，下一帧沿用当前关键帧的位姿重新开始
+            failed++;
+            next = kf+1;
+            frames[next].aligned = false;
+            frames[next].Tcw = T_kf_w;
+        }
+        prev_kf = kf;
+        T_prev_w = T_kf_w;
+        kf = next;
+    }
+    chrono::steady_clock::time_point t_end = chrono::steady_clock::now();
+    double seconds = chrono::duration_cast<chrono::duration<double>> ( t_end-t_start ).count();
+
+    // 按 TUM 格式输出 Twc，只写对齐成功的帧
+    ofstream fout ( trajectory_file );
+    int written = 0;
+    for ( const FrameEntry& frame : frames )
+    {
+        if ( !frame.aligned )
+            continue;
+        Eigen::Isometry3d Twc = frame.Tcw.inverse();
+        Eigen::Quaterniond q ( Twc.rotation() );
+        Eigen::Vector3d t = Twc.translation();
+        fout<<frame.timestamp<<" "<<t[0]<<" "<<t[1]<<" "<<t[2]<<" "
+            <<q.x() <<" "<<q.y() <<" "<<q.z() <<" "<<q.w() <<endl;
+        written++;
+    }
+
+    cout<<written<<"/"<<n<<" frames aligned, "<<keyframes<<" key frames, "<<failed<<" failures"<<endl;
+    cout<<"total "<<seconds<<" s ("<<n/seconds<<" frames/s), key frame preparation "<<time_reference<<" s"<<endl;
+    cout<<"trajectory saved to "<<trajectory_file<<endl;
+    return 0;
+}
@@ -0,0 +1,198 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <string>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/features2d/features2d.hpp>
+
+#include "direct_g2o.h"
+#include "direct_tracker.h"
+#include "direct_tracker_ic.h"
+#include "pixel_selector.h"
+
+// 在同一组帧上对比 g2o 直接法、DirectTracker 与逆向组合 InverseCompositionalTracker 的耗时和光度误差，
+// 两种跟踪器再各跑一个 double 版本，比较 float/double 的耗时与位姿差异
+
+// 两个位姿之间的平移差(m)与旋转差(rad)
+void poseDifference ( const Eigen::Isometry3d& T1, const Eigen::Isometry3d& T2, double& translation, double& rotation )
+{
+    Eigen::Isometry3d diff = T1.inverse() *T2;
+    translation = diff.translation().norm();
+    rotation = Eigen::AngleAxisd ( diff.rotation() ).angle();
+}
+
+// 位姿 Tcw 下所有测量的平均灰度误差(绝对值)，两种方法用同一标准评价
+double photometricError ( const vector<Measurement>& measurements, const cv::Mat& gray,
+                          float fx, float fy, float cx, float cy, const Eigen::Isometry3d& Tcw )
+{
+    double sum = 0;
+    int count = 0;
+    for ( const Measurement& m : measurements )
+    {
+        Eigen::Vector3d p = Tcw*m.pos_world;
+        if ( p[2] <= 0 )
+            continue;
+        double u = fx*p[0]/p[2]+cx, v = fy*p[1]/p[2]+cy;
+        if ( u<1 || v<1 || u>=gray.cols-2 || v>=gray.rows-2 )
+            continue;
+        int x = int ( u ), y = int ( v );
+        double fu = u-x, fv = v-y;
+        const uchar* d = gray.ptr<uchar> ( y ) + x;
+        double g = ( 1-fu ) * ( 1-fv ) *d[0] + fu* ( 1-fv ) *d[1] + ( 1-fu ) *fv*d[gray.step] + fu*fv*d[gray.step+1];
+        sum += std::fabs ( g-m.grayscale );
+        count++;
+    }
+    return count > 0 ? sum/count : -1;
+}
+
+int main ( int argc, char** argv )
+{
+    if ( argc < 2 )
+    {
+        cout<<"usage: direct_benchmark path_to_dataset [num_frames] [sparse|semidense]"<<endl;
+        return 1;
+    }
+    string path_to_dataset = argv[1];
+    int num_frames = argc > 2 ? atoi ( argv[2] ) : 10;
+    bool semidense = argc > 3 && string ( argv[3] ) == "semidense";
+
+    ifstream fin ( path_to_dataset + "/associate.txt" );
+    if ( !fin )
+    {
+        cout<<"please generate the associate file called associate.txt!"<<endl;
+        return 1;
+    }
+
+    // 相机内参
+    float cx = 325.5;
+    float cy = 253.5;
+    float fx = 518.0;
+    float fy = 519.0;
+    float depth_scale = 1000.0;
+    Eigen::Matrix3f K;
+    K<<fx,0.f,cx,0.f,fy,cy,0.f,0.f,1.0f;
+
+    vector<Measurement> measurements;
+    PointBuffer points;
+    DirectTracker tracker ( fx, fy, cx, cy );
+    InverseCompositionalTracker ic_tracker ( fx, fy, cx, cy );
+    DirectTrackerT<double> tracker_double ( fx, fy, cx, cy );
+    InverseCompositionalTrackerT<double> ic_tracker_double ( fx, fy, cx, cy );
+    PixelSelector selector ( fx, fy, cx, cy, depth_scale );
+    Eigen::Isometry3d Tcw_g2o = Eigen::Isometry3d::Identity();
+    Eigen::Isometry3d Tcw_fast = Eigen::Isometry3d::Identity();
+    Eigen::Isometry3d Tcw_ic = Eigen::Isometry3d::Identity();
+    Eigen::Isometry3d Tcw_fast_double = Eigen::Isometry3d::Identity();
+    Eigen::Isometry3d Tcw_ic_double = Eigen::Isometry3d::Identity();
+    double time_g2o = 0, time_fast = 0, time_ic = 0, time_fast_double = 0, time_ic_double = 0;
+    double max_translation = 0, max_rotation = 0;      // float 与 double 结果的最大差异
+    int frames = 0;
+
+    string rgb_file, depth_file, time_rgb, time_depth;
+    cv::Mat color, depth, gray;
+    for ( int index=0; index<num_frames; index++ )
+    {
+        fin>>time_rgb>>rgb_file>>time_depth>>depth_file;
+        if ( !fin )
+            break;
+        color = cv::imread ( path_to_dataset+"/"+rgb_file );
+        depth = cv::imread ( path_to_dataset+"/"+depth_file, -1 );
+        if ( color.data==nullptr || depth.data==nullptr )
+            continue;
+        cv::cvtColor ( color, gray, cv::COLOR_BGR2GRAY );
+
+        if ( measurements.empty() )
+        {
+            // 第一帧作为参考，取点方式与 direct_sparse / direct_semidense 相同
+            if ( semidense )
+            {
+                chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+                selector.select ( gray, depth, points );
+                chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+                cout<<"pixel selection: "<<chrono::duration_cast<chrono::duration<double>> ( t2-t1 ).count() *1000<<" ms"<<endl;
+                for ( size_t i=0; i<points.size(); i++ )
+                    measurements.push_back ( Measurement ( Eigen::Vector3d ( points.x[i], points.y[i], points.z[i] ), points.gray[i] ) );
+            }
+            else
+            {
+                vector<cv::KeyPoint> keypoints;
+                cv::Ptr<cv::FastFeatureDetector> detector = cv::FastFeatureDetector::create();
+                detector->detect ( color, keypoints );
+                for ( auto kp:keypoints )
+                {
+                    if ( kp.pt.x < 20 || kp.pt.y < 20 || ( kp.pt.x+20 ) >color.cols || ( kp.pt.y+20 ) >color.rows )
+                        continue;
+                    int x = cvRound ( kp.pt.x ), y = cvRound ( kp.pt.y );
+                    ushort d = depth.ptr<ushort> ( y ) [x];
+                    if ( d==0 )
+                        continue;
+                    Eigen::Vector3d p3d = project2Dto3D ( x, y, d, fx, fy, cx, cy, depth_scale );
+                    float grayscale = float ( gray.ptr<uchar> ( y ) [x] );
+                    measurements.push_back ( Measurement ( p3d, grayscale ) );
+                    points.push_back ( p3d, grayscale );
+                }
+            }
+            tracker.setReference ( points, gray, Eigen::Isometry3d::Identity() );
+            ic_tracker.setReference ( points, gray, Eigen::Isometry3d::Identity() );
+            tracker_double.setReference ( points, gray, Eigen::Isometry3d::Identity() );
+            ic_tracker_double.setReference ( points, gray, Eigen::Isometry3d::Identity() );
+            cout<<"reference frame: "<<measurements.size() <<" measurements"<<endl;
+            continue;
+        }
+
+        chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+        poseEstimationDirect ( measurements, &gray, K, Tcw_g2o, false );
+        chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+        bool ok = tracker.track ( gray, Tcw_fast );
+        chrono::steady_clock::time_point t3 = chrono::steady_clock::now();
+        bool ok_ic = ic_tracker.track ( gray, Tcw_ic );
+        chrono::steady_clock::time_point t4 = chrono::steady_clock::now();
+        tracker_double.track ( gray, Tcw_fast_double );
+        chrono::steady_clock::time_point t5 = chrono::steady_clock::now();
+        ic_tracker_double.track ( gray, Tcw_ic_double );
+        chrono::steady_clock::time_point t6 = chrono::steady_clock::now();
+
+        double dt_g2o = chrono::duration_cast<chrono::duration<double>> ( t2-t1 ).count();
+        double dt_fast = chrono::duration_cast<chrono::duration<double>> ( t3-t2 ).count();
+        double dt_ic = chrono::duration_cast<chrono::duration<double>> ( t4-t3 ).count();
+        time_g2o += dt_g2o;
+        time_fast += dt_fast;
+        time_ic += dt_ic;
+        time_fast_double += chrono::duration_cast<chrono::duration<double>> ( t5-t4 ).count();
+        time_ic_double += chrono::duration_cast<chrono::duration<double>> ( t6-t5 ).count();
+        frames++;
+
+        double dt, dr;
+        poseDifference ( Tcw_fast, Tcw_fast_double, dt, dr );
+        max_translation = std::max ( max_translation, dt );
+        max_rotation = std::max ( max_rotation, dr );
+        poseDifference ( Tcw_ic, Tcw_ic_double, dt, dr );
+        max_translation = std::max ( max_translation, dt );
+        max_rotation = std::max ( max_rotation, dr );
+
+        Eigen::Isometry3d diff = Tcw_g2o.inverse() *Tcw_fast;
+        cout<<"frame "<<index<<": g2o "<<dt_g2o*1000<<" ms, error "
+            <<photometricError ( measurements, gray, fx, fy, cx, cy, Tcw_g2o )
+            <<" | tracker "<<dt_fast*1000<<" ms, "<<tracker.totalIterations() <<" iterations, error "
+            <<photometricError ( measurements, gray, fx, fy, cx, cy, Tcw_fast )
+            << ( ok ? "" : " (failed)" )
+            <<" | ic "<<dt_ic*1000<<" ms, "<<ic_tracker.totalIterations() <<" iterations, error "
+            <<photometricError ( measurements, gray, fx, fy, cx, cy, Tcw_ic )
+            << ( ok_ic ? "" : " (failed)" )
+            <<" | pose difference "<<diff.translation().norm() <<" m, "
+            <<Eigen::AngleAxisd ( diff.rotation() ).angle() <<" rad"<<endl;
+    }
+
+    if ( frames > 0 )
+    {
+        cout<<"average time: g2o "<<time_g2o/frames*1000<<" ms, tracker "<<time_fast/frames*1000
+            <<" ms, ic "<<time_ic/frames*1000<<" ms, speedup "<<time_g2o/time_fast<<"x / "<<time_g2o/time_ic<<"x"<<endl;
+        cout<<"double precision: tracker "<<time_fast_double/frames*1000<<" ms, ic "<<time_ic_double/frames*1000
+            <<" ms; max float/double pose difference "<<max_translation<<" m, "<<max_rotation<<" rad"<<endl;
+    }
+    return 0;
+}
@@ -0,0 +1,563 @@
+#ifndef DIRECT_TRACKER_H
+#define DIRECT_TRACKER_H
+
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <Eigen/Cholesky>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// 不依赖 g2o 的直接法位姿估计：图像金字塔由粗到精，手写 Gauss-Newton，
+// AVX2 批量双线性采样与雅可比计算(不支持时使用标量版本)，OpenMP 多线程累加法方程
+// 逐点计算的精度由模板参数 Scalar 决定：float 时走 AVX2 (一次 8 个点)，double 作为精度参照；
+// 图像、梯度和参考点按 float 存储，位姿更新与法方程求解始终用 double
+
+// 参考点，各分量分别连续存放 (SoA)，便于向量化
+struct PointBuffer
+{
+    std::vector<float> x, y, z;     // 世界坐标系下的三维点
+    std::vector<float> gray;        // 参考灰度
+
+    size_t size() const { return x.size(); }
+    void clear() { x.clear(); y.clear(); z.clear(); gray.clear(); }
+    void reserve ( size_t n ) { x.reserve ( n ); y.reserve ( n ); z.reserve ( n ); gray.reserve ( n ); }
+    void resize ( size_t n ) { x.resize ( n ); y.resize ( n ); z.resize ( n ); gray.resize ( n ); }
+    void push_back ( const Eigen::Vector3d& p, float g )
+    {
+        x.push_back ( p[0] ); y.push_back ( p[1] ); z.push_back ( p[2] );
+        gray.push_back ( g );
+    }
+};
+
+// 金字塔的一层：灰度图、水平/竖直梯度图和该层的内参
+struct ImageLevel
+{
+    cv::Mat gray;           // CV_8UC1
+    cv::Mat gx, gy;         // CV_32FC1，中心差分
+    float fx, fy, cx, cy;
+};
+
+// 图像金字塔，每层尺寸减半
+class ImagePyramid
+{
+public:
+    // gradient 为 false 时只建灰度金字塔
+    void build ( const cv::Mat& gray, int num_levels, float fx, float fy, float cx, float cy, bool gradient = true )
+    {
+        levels_.resize ( num_levels );
+        for ( int l=0; l<num_levels; l++ )
+        {
+            ImageLevel& level = levels_[l];
+            if ( l==0 )
+                level.gray = gray;
+            else
+                cv::pyrDown ( levels_[l-1].gray, level.gray );
+            float scale = 1.0f / ( 1<<l );
+            level.fx = fx*scale; level.fy = fy*scale;
+            level.cx = cx*scale; level.cy = cy*scale;
+            if ( gradient )
+                computeGradient ( level );
+        }
+    }
+
+    int size() const { return levels_.size(); }
+    const ImageLevel& operator[] ( int l ) const { return levels_[l]; }
+
+private:
+    static void computeGradient ( ImageLevel& level )
+    {
+        const cv::Mat& img = level.gray;
+        level.gx.create ( img.rows, img.cols, CV_32FC1 );
+        level.gy.create ( img.rows, img.cols, CV_32FC1 );
+        level.gx.setTo ( 0 );
+        level.gy.setTo ( 0 );
+        #pragma omp parallel for schedule(static)
+        for ( int y=1; y<img.rows-1; y++ )
+        {
+            const uchar* up = img.ptr<uchar> ( y-1 );
+            const uchar* row = img.ptr<uchar> ( y );
+            const uchar* down = img.ptr<uchar> ( y+1 );
+            float* gx = level.gx.ptr<float> ( y );
+            float* gy = level.gy.ptr<float> ( y );
+            for ( int x=1; x<img.cols-1; x++ )
+            {
+                gx[x] = 0.5f * ( float ( row[x+1] ) - float ( row[x-1] ) );
+                gy[x] = 0.5f * ( float ( down[x] ) - float ( up[x] ) );
+            }
+        }
+    }
+
+    std::vector<ImageLevel> levels_;
+};
+
+// SE3 指数映射，李代数顺序与 g2o 相同：前三维旋转，后三维平移
+inline Eigen::Isometry3d se3Exp ( const Eigen::Matrix<double,6,1>& xi )
+{
+    Eigen::Vector3d omega = xi.head<3>(), upsilon = xi.tail<3>();
+    double theta = omega.norm();
+    Eigen::Matrix3d Omega;
+    Omega << 0, -omega[2], omega[1],
+             omega[2], 0, -omega[0],
+             -omega[1], omega[0], 0;
+    Eigen::Matrix3d R, V;
+    if ( theta < 1e-10 )
+    {
+        R = Eigen::Matrix3d::Identity() + Omega;
+        V = Eigen::Matrix3d::Identity() + 0.5*Omega;
+    }
+    else
+    {
+        R = Eigen::AngleAxisd ( theta, omega/theta ).toRotationMatrix();
+        V = Eigen::Matrix3d::Identity()
+            + ( 1-std::cos ( theta ) ) / ( theta*theta ) * Omega
+            + ( theta-std::sin ( theta ) ) / ( theta*theta*theta ) * Omega*Omega;
+    }
+    Eigen::Isometry3d T = Eigen::Isometry3d::Identity();
+    T.linear() = R;
+    T.translation() = V*upsilon;
+    return T;
+}
+
+// 8 位灰度图双线性插值，调用者保证 (u,v) 与右下相邻像素都在图内
+template<typename Scalar>
+inline Scalar bilinear ( const cv::Mat& img, Scalar u, Scalar v )
+{
+    int x = int ( u ), y = int ( v );
+    Scalar fu = u-x, fv = v-y;
+    const uchar* p = img.ptr<uchar> ( y ) + x;
+    int step = img.step;
+    return ( 1-fu ) * ( 1-fv ) *p[0] + fu* ( 1-fv ) *p[1] + ( 1-fu ) *fv*p[step] + fu*fv*p[step+1];
+}
+
+// float 图双线性插值，整数部分与小数部分已分开
+template<typename Scalar>
+inline Scalar bilinear ( const cv::Mat& img, int x, int y, Scalar fu, Scalar fv )
+{
+    const float* p = img.ptr<float> ( y ) + x;
+    int step = img.step1();
+    return ( 1-fu ) * ( 1-fv ) *p[0] + fu* ( 1-fv ) *p[1] + ( 1-fu ) *fv*p[step] + fu*fv*p[step+1];
+}
+
+#ifdef __AVX2__
+inline float hsum ( __m256 v )
+{
+    __m128 s = _mm_add_ps ( _mm256_castps256_ps128 ( v ), _mm256_extractf128_ps ( v, 1 ) );
+    s = _mm_add_ps ( s, _mm_movehl_ps ( s, s ) );
+    s = _mm_add_ss ( s, _mm_movehdup_ps ( s ) );
+    return _mm_cvtss_f32 ( s );
+}
+#endif
+
+// 法方程 H*dx = -b，H 只存上三角的 21 个元素
+struct NormalEquations
+{
+    double H[21];
+    double b[6];
+    double cost;
+    int count;
+
+    NormalEquations() { clear(); }
+    void clear()
+    {
+        std::fill ( H, H+21, 0.0 );
+        std::fill ( b, b+6, 0.0 );
+        cost = 0;
+        count = 0;
+    }
+    NormalEquations& operator+= ( const NormalEquations& o )
+    {
+        for ( int i=0; i<21; i++ ) H[i] += o.H[i];
+        for ( int i=0; i<6; i++ ) b[i] += o.b[i];
+        cost += o.cost;
+        count += o.count;
+        return *this;
+    }
+    void solve ( Eigen::Matrix<double,6,1>& dx ) const
+    {
+        Eigen::Matrix<double,6,6> A;
+        Eigen::Matrix<double,6,1> B;
+        int k = 0;
+        for ( int i=0; i<6; i++ )
+        {
+            for ( int j=i; j<6; j++ )
+                A ( i,j ) = A ( j,i ) = H[k++];
+            B[i] = b[i];
+        }
+        dx = A.ldlt().solve ( -B );
+    }
+};
+
+// 一个块内的累加量，用 Scalar 累加，块结束后并入 double 的 NormalEquations
+template<typename Scalar>
+struct BlockSums
+{
+    Scalar H[21];
+    Scalar b[6];
+    Scalar cost;
+    int count;
+
+    BlockSums() { clear(); }
+    void clear()
+    {
+        std::fill ( H, H+21, Scalar ( 0 ) );
+        std::fill ( b, b+6, Scalar ( 0 ) );
+        cost = 0;
+        count = 0;
+    }
+    // 加入一个残差，J 为 1x6 雅可比，w 为鲁棒核权重
+    inline void add ( const Scalar* J, Scalar e, Scalar w, Scalar cost_e )
+    {
+        int k = 0;
+        for ( int i=0; i<6; i++ )
+        {
+            Scalar wJ = w*J[i];
+            for ( int j=i; j<6; j++ )
+                H[k++] += wJ*J[j];
+            b[i] += wJ*e;
+        }
+        cost += cost_e;
+        count++;
+    }
+    void flush ( NormalEquations& ne )
+    {
+        for ( int i=0; i<21; i++ ) ne.H[i] += H[i];
+        for ( int i=0; i<6; i++ ) ne.b[i] += b[i];
+        ne.cost += cost;
+        ne.count += count;
+        clear();
+    }
+};
+
+struct DirectTrackerOptions
+{
+    int levels;                 // 金字塔层数
+    int iterations;             // 每层最大迭代次数
+    float huber;                // Huber 核阈值(灰度)
+    int min_points;             // 有效点少于此数认为失败
+
+    DirectTrackerOptions() : levels ( 4 ), iterations ( 10 ), huber ( 20.0f ), min_points ( 20 ) {}
+};
+
+template<typename Scalar>
+class DirectTrackerT
+{
+public:
+    typedef DirectTrackerOptions Options;
+    typedef Eigen::Matrix<Scalar,3,3> Matrix3;
+    typedef Eigen::Matrix<Scalar,3,1> Vector3;
+
+    DirectTrackerT ( float fx, float fy, float cx, float cy, const Options& options = Options() )
+        : fx_ ( fx ), fy_ ( fy ), cx_ ( cx ), cy_ ( cy ), options_ ( options ) {}
+
+    // 设置参考帧：参考点(世界坐标)、参考灰度图和参考帧位姿
+    // 粗层的参考灰度在参考图的对应层上采样得到
+    void setReference ( const PointBuffer& points, const cv::Mat& ref_gray, const Eigen::Isometry3d& T_ref_w )
+    {
+        points_ = points;
+        ImagePyramid ref_pyramid;
+        ref_pyramid.build ( ref_gray, options_.levels, fx_, fy_, cx_, cy_ );
+        ref_gray_.assign ( options_.levels, std::vector<float> ( points_.size() ) );
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+        for ( int l=0; l<options_.levels; l++ )
+        {
+            const ImageLevel& level = ref_pyramid[l];
+            for ( size_t i=0; i<points_.size(); i++ )
+            {
+                Eigen::Vector3d p = T_ref_w * Eigen::Vector3d ( points_.x[i], points_.y[i], points_.z[i] );
+                float u = level.fx*p[0]/p[2] + level.cx;
+                float v = level.fy*p[1]/p[2] + level.cy;
+                if ( p[2]<=0 || u<1 || v<1 || u>=level.gray.cols-2 || v>=level.gray.rows-2 )
+                    ref_gray_[l][i] = nan;
+                else if ( l==0 )
+                    ref_gray_[l][i] = points_.gray[i];
+                else
+                    ref_gray_[l][i] = bilinear ( level.gray, u, v );
+            }
+        }
+    }
+
+    // 设置当前灰度图，建立金字塔；track 会调用它，单独调用后可直接用 accumulate
+    void setImage ( const cv::Mat& gray )
+    {
+        pyramid_.build ( gray, options_.levels, fx_, fy_, cx_, cy_ );
+    }
+
+    // 估计当前灰度图的位姿，Tcw 作为初值传入
+    bool track ( const cv::Mat& gray, Eigen::Isometry3d& Tcw )
+    {
+        setImage ( gray );
+        total_iterations_ = 0;
+        for ( int l=options_.levels-1; l>=0; l-- )
+        {
+            double last_cost = std::numeric_limits<double>::max();
+            Eigen::Isometry3d T_prev = Tcw;
+            for ( int it=0; it<options_.iterations; it++ )
+            {
+                NormalEquations ne;
+                accumulate ( l, Tcw, ne );
+                total_iterations_++;
+                if ( ne.count < options_.min_points )
+                    return false;
+                double cost = ne.cost / ne.count;
+                if ( cost > last_cost )
+                {
+                    // 代价上升，退回上一步
+                    Tcw = T_prev;
+                    break;
+                }
+                last_cost = cost;
+                last_cost_ = cost;
+                num_valid_ = ne.count;
+
+                Eigen::Matrix<double,6,1> dx;
+                ne.solve ( dx );
+                if ( !std::isfinite ( dx[0] ) )
+                    return false;
+                T_prev = Tcw;
+                Tcw = se3Exp ( dx ) * Tcw;
+                if ( dx.norm() < 1e-6 )
+                    break;
+            }
+        }
+        return true;
+    }
+
+    int totalIterations() const { return total_iterations_; }
+    double lastCost() const { return last_cost_; }      // 最后一次迭代的平均鲁棒代价
+    int numValid() const { return num_valid_; }         // 最后一次迭代的有效点数
+
+    // 对所有点在第 l 层、位姿 Tcw 下累加法方程，按块分给各线程后归并
+    void accumulate ( int l, const Eigen::Isometry3d& Tcw, NormalEquations& total ) const
+    {
+        const int n = points_.size();
+        const int num_blocks = ( n+BLOCK-1 ) / BLOCK;
+        Matrix3 R = Tcw.rotation().template cast<Scalar>();
+        Vector3 t = Tcw.translation().template cast<Scalar>();
+        total.clear();
+        #pragma omp parallel
+        {
+            NormalEquations local;
+            #pragma omp for schedule(static) nowait
+            for ( int block=0; block<num_blocks; block++ )
+                accumulateBlock ( l, R, t, block*BLOCK, std::min ( n, ( block+1 ) *BLOCK ), local );
+            #pragma omp critical
+            total += local;
+        }
+    }
+
+private:
+    static const int BLOCK = 256;   // 块内用 Scalar 累加，块结束后并入 double
+
+    // 单个点的残差与雅可比；无效点返回 false
+    inline bool evaluate ( const ImageLevel& level, const float* ref, const Matrix3& R, const Vector3& t,
+                           int i, Scalar* J, Scalar& e ) const
+    {
+        if ( ! ( ref[i]==ref[i] ) )
+            return false;
+        Scalar X = R ( 0,0 ) *points_.x[i] + R ( 0,1 ) *points_.y[i] + R ( 0,2 ) *points_.z[i] + t[0];
+        Scalar Y = R ( 1,0 ) *points_.x[i] + R ( 1,1 ) *points_.y[i] + R ( 1,2 ) *points_.z[i] + t[1];
+        Scalar Z = R ( 2,0 ) *points_.x[i] + R ( 2,1 ) *points_.y[i] + R ( 2,2 ) *points_.z[i] + t[2];
+        if ( Z<=0 )
+            return false;
+        Scalar invz = Scalar ( 1 ) /Z, invz2 = invz*invz;
+        Scalar u = level.fx*X*invz + level.cx;
+        Scalar v = level.fy*Y*invz + level.cy;
+        if ( u<1 || v<1 || u>=level.gray.cols-2 || v>=level.gray.rows-2 )
+            return false;
+        int x0 = int ( u ), y0 = int ( v );
+        Scalar fu = u-x0, fv = v-y0;
+        e = bilinear ( level.gray, u, v ) - ref[i];
+        Scalar gx = bilinear ( level.gx, x0, y0, fu, fv );
+        Scalar gy = bilinear ( level.gy, x0, y0, fu, fv );
+
+        // 灰度梯度乘以像素对 se3 的雅可比，与 EdgeSE3ProjectDirect 一致
+        Scalar fx = level.fx, fy = level.fy;
+        J[0] = -gx*X*Y*invz2*fx - gy* ( 1+Y*Y*invz2 ) *fy;
+        J[1] = gx* ( 1+X*X*invz2 ) *fx + gy*X*Y*invz2*fy;
+        J[2] = -gx*Y*invz*fx + gy*X*invz*fy;
+        J[3] = gx*invz*fx;
+        J[4] = gy*invz*fy;
+        J[5] = -gx*X*invz2*fx - gy*Y*invz2*fy;
+        return true;
+    }
+
+    void accumulateBlock ( int l, const Matrix3& R, const Vector3& t, int begin, int end, NormalEquations& ne ) const
+    {
+        const ImageLevel& level = pyramid_[l];
+        const float* ref = ref_gray_[l].data();
+        const Scalar k = options_.huber;
+        int i = begin;
+#ifdef __AVX2__
+        if ( std::is_same<Scalar,float>::value )
+            i = accumulateBlockAVX2 ( level, ref, R.template cast<float>(), t.template cast<float>(), begin, end, ne );
+#endif
+        // 标量处理剩余的点
+        BlockSums<Scalar> sums;
+        Scalar J[6], e;
+        for ( ; i<end; i++ )
+        {
+            if ( !evaluate ( level, ref, R, t, i, J, e ) )
+                continue;
+            Scalar ae = std::fabs ( e );
+            Scalar w = ae<=k ? Scalar ( 1 ) : k/ae;
+            sums.add ( J, e, w, ae<=k ? e*e : k* ( 2*ae-k ) );
+        }
+        sums.flush ( ne );
+    }
+
+#ifdef __AVX2__
+    // 每次处理 8 个点，返回第一个未处理的点
+    int accumulateBlockAVX2 ( const ImageLevel& level, const float* ref, const Eigen::Matrix3f& R, const Eigen::Vector3f& t,
+                              int begin, int end, NormalEquations& ne ) const
+    {
+        const __m256 r00 = _mm256_set1_ps ( R ( 0,0 ) ), r01 = _mm256_set1_ps ( R ( 0,1 ) ), r02 = _mm256_set1_ps ( R ( 0,2 ) );
+        const __m256 r10 = _mm256_set1_ps ( R ( 1,0 ) ), r11 = _mm256_set1_ps ( R ( 1,1 ) ), r12 = _mm256_set1_ps ( R ( 1,2 ) );
+        const __m256 r20 = _mm256_set1_ps ( R ( 2,0 ) ), r21 = _mm256_set1_ps ( R ( 2,1 ) ), r22 = _mm256_set1_ps ( R ( 2,2 ) );
+        const __m256 t0 = _mm256_set1_ps ( t[0] ), t1 = _mm256_set1_ps ( t[1] ), t2 = _mm256_set1_ps ( t[2] );
+        const __m256 fx = _mm256_set1_ps ( level.fx ), fy = _mm256_set1_ps ( level.fy );
+        const __m256 cx = _mm256_set1_ps ( level.cx ), cy = _mm256_set1_ps ( level.cy );
+        const __m256 one = _mm256_set1_ps ( 1.0f ), zero = _mm256_setzero_ps();
+        const __m256 umax = _mm256_set1_ps ( level.gray.cols-2 ), vmax = _mm256_set1_ps ( level.gray.rows-2 );
+        const __m256 k = _mm256_set1_ps ( options_.huber );
+        const __m256 sign_mask = _mm256_set1_ps ( -0.0f );
+        const __m256i byte_mask = _mm256_set1_epi32 ( 0xff );
+        const __m256i step = _mm256_set1_epi32 ( level.gray.step );
+        const __m256i gstep = _mm256_set1_epi32 ( level.gx.step1() );
+        const int* image = reinterpret_cast<const int*> ( level.gray.data );
+        const float* gx_data = level.gx.ptr<float>();
+        const float* gy_data = level.gy.ptr<float>();
+
+        __m256 H[21], b[6], cost = zero, count = zero;
+        for ( int j=0; j<21; j++ ) H[j] = zero;
+        for ( int j=0; j<6; j++ ) b[j] = zero;
+
+        int i = begin;
+        for ( ; i+8<=end; i+=8 )
+        {
+            __m256 px = _mm256_loadu_ps ( &points_.x[i] ), py = _mm256_loadu_ps ( &points_.y[i] ), pz = _mm256_loadu_ps ( &points_.z[i] );
+            __m256 r = _mm256_loadu_ps ( ref+i );
+            __m256 X = _mm256_fmadd_ps ( r00, px, _mm256_fmadd_ps ( r01, py, _mm256_fmadd_ps ( r02, pz, t0 ) ) );
+            __m256 Y = _mm256_fmadd_ps ( r10, px, _mm256_fmadd_ps ( r11, py, _mm256_fmadd_ps ( r12, pz, t1 ) ) );
+            __m256 Z = _mm256_fmadd_ps ( r20, px, _mm256_fmadd_ps ( r21, py, _mm256_fmadd_ps ( r22, pz, t2 ) ) );
+            __m256 invz = _mm256_div_ps ( one, Z );
+            __m256 u = _mm256_fmadd_ps ( _mm256_mul_ps ( fx, X ), invz, cx );
+            __m256 v = _mm256_fmadd_ps ( _mm256_mul_ps ( fy, Y ), invz, cy );
+
+            // 有效：参考灰度存在、深度为正、投影在图像内
+            __m256 valid = _mm256_cmp_ps ( r, r, _CMP_ORD_Q );
+            valid = _mm256_and_ps ( valid, _mm256_cmp_ps ( Z, zero, _CMP_GT_OQ ) );
+            valid = _mm256_and_ps ( valid, _mm256_cmp_ps ( u, one, _CMP_GE_OQ ) );
+            valid = _mm256_and_ps ( valid, _mm256_cmp_ps ( v, one, _CMP_GE_OQ ) );
+            valid = _mm256_and_ps ( valid, _mm256_cmp_ps ( u, umax, _CMP_LT_OQ ) );
+            valid = _mm256_and_ps ( valid, _mm256_cmp_ps ( v, vmax, _CMP_LT_OQ ) );
+            if ( _mm256_movemask_ps ( valid ) == 0 )
+                continue;
+            // 无效的点换成安全坐标，保证 gather 不越界
+            u = _mm256_blendv_ps ( one, u, valid );
+            v = _mm256_blendv_ps ( one, v, valid );
+            // 深度接近 0 或为负时 1/Z 溢出，雅可比会出现 inf，乘上 0 权重后变成 NaN，因此无效点的三维坐标也换成 (0,0,1)
+            X = _mm256_blendv_ps ( zero, X, valid );
+            Y = _mm256_blendv_ps ( zero, Y, valid );
+            Z = _mm256_blendv_ps ( one, Z, valid );
+            invz = _mm256_div_ps ( one, Z );
+            __m256 invz2 = _mm256_mul_ps ( invz, invz );
+
+            __m256i x0 = _mm256_cvttps_epi32 ( u ), y0 = _mm256_cvttps_epi32 ( v );
+            __m256 fu = _mm256_sub_ps ( u, _mm256_cvtepi32_ps ( x0 ) );
+            __m256 fv = _mm256_sub_ps ( v, _mm256_cvtepi32_ps ( y0 ) );
+            __m256 w11 = _mm256_mul_ps ( fu, fv );
+            __m256 w10 = _mm256_sub_ps ( fv, w11 );                 // (1-fu)*fv
+            __m256 w01 = _mm256_sub_ps ( fu, w11 );                 // fu*(1-fv)
+            __m256 w00 = _mm256_sub_ps ( _mm256_sub_ps ( one, fu ), w10 );
+
+            // 灰度：一次取 4 字节，低两个字节是相邻两个像素
+            __m256i idx = _mm256_add_epi32 ( _mm256_mullo_epi32 ( y0, step ), x0 );
+            __m256i top = _mm256_i32gather_epi32 ( image, idx, 1 );
+            __m256i bottom = _mm256_i32gather_epi32 ( image, _mm256_add_epi32 ( idx, step ), 1 );
+            __m256 i00 = _mm256_cvtepi32_ps ( _mm256_and_si256 ( top, byte_mask ) );
+            __m256 i01 = _mm256_cvtepi32_ps ( _mm256_and_si256 ( _mm256_srli_epi32 ( top, 8 ), byte_mask ) );
+            __m256 i10 = _mm256_cvtepi32_ps ( _mm256_and_si256 ( bottom, byte_mask ) );
+            __m256 i11 = _mm256_cvtepi32_ps ( _mm256_and_si256 ( _mm256_srli_epi32 ( bottom, 8 ), byte_mask ) );
+            __m256 I = _mm256_fmadd_ps ( w00, i00, _mm256_fmadd_ps ( w01, i01, _mm256_fmadd_ps ( w10, i10, _mm256_mul_ps ( w11, i11 ) ) ) );
+
+            // 梯度
+            __m256i gidx = _mm256_add_epi32 ( _mm256_mullo_epi32 ( y0, gstep ), x0 );
+            __m256i gidx1 = _mm256_add_epi32 ( gidx, gstep );
+            __m256i one_i = _mm256_set1_epi32 ( 1 );
+            __m256 gx = _mm256_fmadd_ps ( w00, _mm256_i32gather_ps ( gx_data, gidx, 4 ),
+                        _mm256_fmadd_ps ( w01, _mm256_i32gather_ps ( gx_data, _mm256_add_epi32 ( gidx, one_i ), 4 ),
+                        _mm256_fmadd_ps ( w10, _mm256_i32gather_ps ( gx_data, gidx1, 4 ),
+                        _mm256_mul_ps ( w11, _mm256_i32gather_ps ( gx_data, _mm256_add_epi32 ( gidx1, one_i ), 4 ) ) ) ) );
+            __m256 gy = _mm256_fmadd_ps ( w00, _mm256_i32gather_ps ( gy_data, gidx, 4 ),
+                        _mm256_fmadd_ps ( w01, _mm256_i32gather_ps ( gy_data, _mm256_add_epi32 ( gidx, one_i ), 4 ),
+                        _mm256_fmadd_ps ( w10, _mm256_i32gather_ps ( gy_data, gidx1, 4 ),
+                        _mm256_mul_ps ( w11, _mm256_i32gather_ps ( gy_data, _mm256_add_epi32 ( gidx1, one_i ), 4 ) ) ) ) );
+
+            // 残差与 Huber 权重，无效点权重为 0
+            __m256 e = _mm256_sub_ps ( I, _mm256_blendv_ps ( zero, r, valid ) );
+            __m256 ae = _mm256_andnot_ps ( sign_mask, e );
+            __m256 inlier = _mm256_cmp_ps ( ae, k, _CMP_LE_OQ );
+            __m256 w = _mm256_blendv_ps ( _mm256_div_ps ( k, ae ), one, inlier );
+            w = _mm256_and_ps ( w, valid );
+            __m256 c = _mm256_blendv_ps ( _mm256_mul_ps ( k, _mm256_sub_ps ( _mm256_add_ps ( ae, ae ), k ) ), _mm256_mul_ps ( e, e ), inlier );
+            cost = _mm256_add_ps ( cost, _mm256_and_ps ( c, valid ) );
+            count = _mm256_add_ps ( count, _mm256_and_ps ( one, valid ) );
+
+            // 雅可比
+            __m256 gxfx = _mm256_mul_ps ( gx, fx ), gyfy = _mm256_mul_ps ( gy, fy );
+            __m256 xy = _mm256_mul_ps ( _mm256_mul_ps ( X, Y ), invz2 );
+            __m256 xx = _mm256_mul_ps ( _mm256_mul_ps ( X, X ), invz2 );
+            __m256 yy = _mm256_mul_ps ( _mm256_mul_ps ( Y, Y ), invz2 );
+            __m256 J[6];
+            J[0] = _mm256_sub_ps ( _mm256_sub_ps ( zero, _mm256_mul_ps ( gxfx, xy ) ), _mm256_mul_ps ( gyfy, _mm256_add_ps ( one, yy ) ) );
+            J[1] = _mm256_fmadd_ps ( gxfx, _mm256_add_ps ( one, xx ), _mm256_mul_ps ( gyfy, xy ) );
+            J[2] = _mm256_mul_ps ( _mm256_sub_ps ( _mm256_mul_ps ( gyfy, X ), _mm256_mul_ps ( gxfx, Y ) ), invz );
+            J[3] = _mm256_mul_ps ( gxfx, invz );
+            J[4] = _mm256_mul_ps ( gyfy, invz );
+            J[5] = _mm256_sub_ps ( zero, _mm256_mul_ps ( _mm256_fmadd_ps ( gxfx, X, _mm256_mul_ps ( gyfy, Y ) ), invz2 ) );
+
+            int m = 0;
+            for ( int a=0; a<6; a++ )
+            {
+                __m256 wJ = _mm256_mul_ps ( w, J[a] );
+                for ( int bb=a; bb<6; bb++ )
+                {
+                    H[m] = _mm256_fmadd_ps ( wJ, J[bb], H[m] );
+                    m++;
+                }
+                b[a] = _mm256_fmadd_ps ( wJ, e, b[a] );
+            }
+        }
+
+        for ( int j=0; j<21; j++ ) ne.H[j] += hsum ( H[j] );
+        for ( int j=0; j<6; j++ ) ne.b[j] += hsum ( b[j] );
+        ne.cost += hsum ( cost );
+        ne.count += int ( hsum ( count ) );
+        return i;
+    }
+#endif
+
+    float fx_, fy_, cx_, cy_;
+    Options options_;
+    PointBuffer points_;
+    std::vector<std::vector<float>> ref_gray_;  // 各层参考灰度，NaN 表示该层无效
+    ImagePyramid pyramid_;
+
+    int total_iterations_ = 0;
+    double last_cost_ = 0;
+    int num_valid_ = 0;
+};
+
+typedef DirectTrackerT<float> DirectTracker;
+
+#endif // DIRECT_TRACKER_H
@@ -0,0 +1,80 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include <opencv2/core/core.hpp>
+
+#include "direct_tracker.h"
+
+using namespace std;
+
+// 检查 DirectTracker (float，开启 AVX2 时走向量化路径) 与 double 版本 (标量路径) 累加出的法方程是否一致。
+// 点集中混有经过当前位姿后落到相机平面上或相机后方的点，标量路径跳过它们，向量化路径也不能被它们污染
+
+int main ( int argc, char** argv )
+{
+    const float fx = 517.3f, fy = 516.5f, cx = 325.1f, cy = 249.7f;
+    const int width = 640, height = 480;
+
+    // 平滑的合成纹理，保证梯度处处存在
+    cv::Mat gray ( height, width, CV_8UC1 );
+    for ( int y=0; y<height; y++ )
+        for ( int x=0; x<width; x++ )
+            gray.ptr<uchar> ( y ) [x] = uchar ( 128 + 60*std::sin ( x*0.05 ) + 50*std::cos ( y*0.07 + x*0.01 ) );
+
+    // 参考帧位于世界原点。当前位姿沿 z 轴后退 0.5 m，深度为 0.5 的点落到相机平面上 (Z=0)，
+    // 深度 0.4 的点到了相机后方，深度 0.5000001 的点 1/Z 溢出；这些点在参考帧中都是有效的
+    PointBuffer points;
+    const float special[] = { 0.5f, 0.4f, 0.5000001f };
+    int num_special = 0;
+    for ( int i=0; i<2000; i++ )
+    {
+        int x = 40 + ( i*37 ) % ( width-80 ), y = 40 + ( i*53 ) % ( height-80 );
+        float z = i%7==3 ? special[ ( num_special++ ) %3] : 2.0f + ( i%11 ) *0.2f;
+        Eigen::Vector3d p ( ( x-cx ) *z/fx, ( y-cy ) *z/fy, z );
+        points.push_back ( p, gray.ptr<uchar> ( y ) [x] );
+    }
+
+    Eigen::Isometry3d Tcw = Eigen::Isometry3d::Identity();
+    Tcw.translation() = Eigen::Vector3d ( 0.01, -0.02, -0.5 );
+
+    DirectTrackerT<float> tracker_float ( fx, fy, cx, cy );
+    DirectTrackerT<double> tracker_double ( fx, fy, cx, cy );
+    tracker_float.setReference ( points, gray, Eigen::Isometry3d::Identity() );
+    tracker_double.setReference ( points, gray, Eigen::Isometry3d::Identity() );
+    tracker_float.setImage ( gray );
+    tracker_double.setImage ( gray );
+
+    bool ok = true;
+    for ( int l=0; l<2; l++ )
+    {
+        NormalEquations ne_float, ne_double;
+        tracker_float.accumulate ( l, Tcw, ne_float );
+        tracker_double.accumulate ( l, Tcw, ne_double );
+
+        double scale = 1, max_diff = 0;
+        bool finite = true;
+        for ( int i=0; i<21; i++ )
+        {
+            finite = finite && std::isfinite ( ne_float.H[i] );
+            scale = max ( scale, fabs ( ne_double.H[i] ) );
+            max_diff = max ( max_diff, fabs ( ne_float.H[i]-ne_double.H[i] ) );
+        }
+        double b_scale = 1, b_diff = 0;
+        for ( int i=0; i<6; i++ )
+        {
+            finite = finite && std::isfinite ( ne_float.b[i] );
+            b_scale = max ( b_scale, fabs ( ne_double.b[i] ) );
+            b_diff = max ( b_diff, fabs ( ne_float.b[i]-ne_double.b[i] ) );
+        }
+        bool level_ok = finite && ne_float.count == ne_double.count
+                        && max_diff/scale < 1e-3 && b_diff/b_scale < 1e-3;
+        cout<<"level "<<l<<": valid points "<<ne_float.count<<" (float) / "<<ne_double.count<<" (double), "
+            <<"relative difference H "<<max_diff/scale<<", b "<<b_diff/b_scale
+            << ( finite ? "" : ", non-finite entries" ) << ( level_ok ? "  ok" : "  FAILED" ) <<endl;
+        ok = ok && level_ok;
+    }
+    cout<< ( ok ? "passed" : "failed" ) <<endl;
+    return ok ? 0 : 1;
+}
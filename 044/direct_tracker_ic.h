@@ -0,0 +1,325 @@
+#ifndef DIRECT_TRACKER_IC_H
+#define DIRECT_TRACKER_IC_H
+
+#include "direct_tracker.h"
+
+// 逆向组合 (inverse compositional) 直接法
+// 雅可比取参考图上的梯度，每个参考帧每层只计算一次，Hessian 也预先累加好；
+// 迭代时只需计算残差：b 逐点累加，H 只减去越界点和 Huber 降权点的贡献
+//
+// 残差 r = I_cur(pi(T*P)) - I_ref(pi(exp(d)*P))，P 为参考相机坐标系下的点，
+// 解出 d 后更新 T = T * exp(d)^-1，T 为参考帧到当前帧的变换
+// 预计算数据与逐点计算的精度为 Scalar，float 时走 AVX2
+template<typename Scalar>
+class InverseCompositionalTrackerT
+{
+public:
+    typedef DirectTrackerOptions Options;
+    typedef Eigen::Matrix<Scalar,3,3> Matrix3;
+    typedef Eigen::Matrix<Scalar,3,1> Vector3;
+
+    InverseCompositionalTrackerT ( float fx, float fy, float cx, float cy, const Options& options = Options() )
+        : fx_ ( fx ), fy_ ( fy ), cx_ ( cx ), cy_ ( cy ), options_ ( options ) {}
+
+    // 设置参考帧并预计算各层的参考灰度、雅可比和 Hessian
+    void setReference ( const PointBuffer& points, const cv::Mat& ref_gray, const Eigen::Isometry3d& T_ref_w )
+    {
+        T_ref_w_ = T_ref_w;
+        ImagePyramid ref_pyramid;
+        ref_pyramid.build ( ref_gray, options_.levels, fx_, fy_, cx_, cy_ );
+        levels_.assign ( options_.levels, Level() );
+        for ( int l=0; l<options_.levels; l++ )
+        {
+            const ImageLevel& image = ref_pyramid[l];
+            Level& level = levels_[l];
+            level.reserve ( points.size() );
+            for ( size_t i=0; i<points.size(); i++ )
+            {
+                Eigen::Vector3d p = T_ref_w * Eigen::Vector3d ( points.x[i], points.y[i], points.z[i] );
+                Scalar X = p[0], Y = p[1], Z = p[2];
+                if ( Z<=0 )
+                    continue;
+                Scalar u = image.fx*X/Z + image.cx;
+                Scalar v = image.fy*Y/Z + image.cy;
+                if ( u<1 || v<1 || u>=image.gray.cols-2 || v>=image.gray.rows-2 )
+                    continue;
+                int x0 = int ( u ), y0 = int ( v );
+                Scalar gx = bilinear ( image.gx, x0, y0, u-x0, v-y0 );
+                Scalar gy = bilinear ( image.gy, x0, y0, u-x0, v-y0 );
+
+                // 参考图梯度乘以像素对 se3 的雅可比
+                Scalar invz = Scalar ( 1 ) /Z, invz2 = invz*invz;
+                Scalar gxfx = gx*image.fx, gyfy = gy*image.fy;
+                Scalar J[6];
+                J[0] = -gxfx*X*Y*invz2 - gyfy* ( 1+Y*Y*invz2 );
+                J[1] = gxfx* ( 1+X*X*invz2 ) + gyfy*X*Y*invz2;
+                J[2] = ( gyfy*X - gxfx*Y ) *invz;
+                J[3] = gxfx*invz;
+                J[4] = gyfy*invz;
+                J[5] = - ( gxfx*X + gyfy*Y ) *invz2;
+
+                level.x.push_back ( X );
+                level.y.push_back ( Y );
+                level.z.push_back ( Z );
+                level.ref.push_back ( l==0 ? Scalar ( points.gray[i] ) : bilinear ( image.gray, u, v ) );
+                for ( int k=0; k<6; k++ )
+                    level.J[k].push_back ( J[k] );
+                int m = 0;
+                for ( int a=0; a<6; a++ )
+                    for ( int b=a; b<6; b++ )
+                        level.H[m++] += double ( J[a] ) *J[b];
+            }
+        }
+    }
+
+    // 估计当前灰度图的位姿，Tcw 作为初值传入
+    bool track ( const cv::Mat& gray, Eigen::Isometry3d& Tcw )
+    {
+        pyramid_.build ( gray, options_.levels, fx_, fy_, cx_, cy_, false );
+        Eigen::Isometry3d T = Tcw * T_ref_w_.inverse();     // 参考帧到当前帧
+        total_iterations_ = 0;
+        for ( int l=options_.levels-1; l>=0; l-- )
+        {
+            double last_cost = std::numeric_limits<double>::max();
+            Eigen::Isometry3d T_prev = T;
+            for ( int it=0; it<options_.iterations; it++ )
+            {
+                NormalEquations ne;
+                accumulate ( l, T, ne );
+                total_iterations_++;
+                if ( ne.count < options_.min_points )
+                    return false;
+                double cost = ne.cost / ne.count;
+                if ( cost > last_cost )
+                {
+                    T = T_prev;
+                    break;
+                }
+                last_cost = cost;
+                last_cost_ = cost;
+                num_valid_ = ne.count;
+
+                // solve 给出 -H^-1 b = -d，exp(d)^-1 = exp(-d)
+                Eigen::Matrix<double,6,1> dx;
+                ne.solve ( dx );
+                if ( !std::isfinite ( dx[0] ) )
+                    return false;
+                T_prev = T;
+                T = T * se3Exp ( dx );
+                if ( dx.norm() < 1e-6 )
+                    break;
+            }
+        }
+        Tcw = T * T_ref_w_;
+        return true;
+    }
+
+    int totalIterations() const { return total_iterations_; }
+    double lastCost() const { return last_cost_; }
+    int numValid() const { return num_valid_; }
+
+    // 第 l 层在变换 T (参考帧到当前帧) 下的法方程：预计算的 H 加上各线程的修正量
+    void accumulate ( int l, const Eigen::Isometry3d& T, NormalEquations& total ) const
+    {
+        const Level& level = levels_[l];
+        const int n = level.x.size();
+        const int num_blocks = ( n+BLOCK-1 ) / BLOCK;
+        Matrix3 R = T.rotation().template cast<Scalar>();
+        Vector3 t = T.translation().template cast<Scalar>();
+        total.clear();
+        #pragma omp parallel
+        {
+            NormalEquations local;
+            #pragma omp for schedule(static) nowait
+            for ( int block=0; block<num_blocks; block++ )
+                accumulateBlock ( l, R, t, block*BLOCK, std::min ( n, ( block+1 ) *BLOCK ), local );
+            #pragma omp critical
+            total += local;
+        }
+        for ( int k=0; k<21; k++ )
+            total.H[k] += level.H[k];
+    }
+
+private:
+    static const int BLOCK = 256;
+
+    // 一层的参考数据，按分量连续存放
+    struct Level
+    {
+        std::vector<Scalar> x, y, z;    // 参考相机坐标系下的点
+        std::vector<Scalar> ref;        // 参考灰度
+        std::vector<Scalar> J[6];       // 预计算的雅可比
+        double H[21];                   // 所有点的 J^T*J (上三角)
+
+        Level() { std::fill ( H, H+21, 0.0 ); }
+        void reserve ( size_t n )
+        {
+            x.reserve ( n ); y.reserve ( n ); z.reserve ( n ); ref.reserve ( n );
+            for ( int k=0; k<6; k++ ) J[k].reserve ( n );
+        }
+    };
+
+    // 从 H 中去掉第 i 个点 (1-w) 倍的贡献，Sums 为 NormalEquations 或 BlockSums
+    template<typename Sums>
+    static inline void removeFromHessian ( const Level& level, int i, Scalar scale, Sums& sums )
+    {
+        Scalar J[6];
+        for ( int k=0; k<6; k++ )
+            J[k] = level.J[k][i];
+        int m = 0;
+        for ( int a=0; a<6; a++ )
+            for ( int b=a; b<6; b++ )
+                sums.H[m++] -= scale*J[a]*J[b];
+    }
+
+    void accumulateBlock ( int l, const Matrix3& R, const Vector3& t, int begin, int end, NormalEquations& ne ) const
+    {
+        const Level& level = levels_[l];
+        const ImageLevel& image = pyramid_[l];
+        const Scalar k = options_.huber;
+        int i = accumulateBlockSIMD ( l, R, t, begin, end, ne, std::is_same<Scalar,float>() );
+        BlockSums<Scalar> sums;
+        for ( ; i<end; i++ )
+        {
+            Scalar X = R ( 0,0 ) *level.x[i] + R ( 0,1 ) *level.y[i] + R ( 0,2 ) *level.z[i] + t[0];
+            Scalar Y = R ( 1,0 ) *level.x[i] + R ( 1,1 ) *level.y[i] + R ( 1,2 ) *level.z[i] + t[1];
+            Scalar Z = R ( 2,0 ) *level.x[i] + R ( 2,1 ) *level.y[i] + R ( 2,2 ) *level.z[i] + t[2];
+            Scalar u = image.fx*X/Z + image.cx;
+            Scalar v = image.fy*Y/Z + image.cy;
+            if ( Z<=0 || u<1 || v<1 || u>=image.gray.cols-2 || v>=image.gray.rows-2 )
+            {
+                removeFromHessian ( level, i, Scalar ( 1 ), sums );
+                continue;
+            }
+            Scalar e = bilinear ( image.gray, u, v ) - level.ref[i];
+            Scalar ae = std::fabs ( e );
+            Scalar w = ae<=k ? Scalar ( 1 ) : k/ae;
+            if ( w < 1 )
+                removeFromHessian ( level, i, 1-w, sums );
+            for ( int a=0; a<6; a++ )
+                sums.b[a] += w*level.J[a][i]*e;
+            sums.cost += ae<=k ? e*e : k* ( 2*ae-k );
+            sums.count++;
+        }
+        sums.flush ( ne );
+    }
+
+    // double 版本没有向量化路径，全部由标量循环处理
+    int accumulateBlockSIMD ( int, const Matrix3&, const Vector3&, int begin, int, NormalEquations&, std::false_type ) const
+    {
+        return begin;
+    }
+
+    int accumulateBlockSIMD ( int l, const Matrix3& R, const Vector3& t, int begin, int end, NormalEquations& ne, std::true_type ) const
+    {
+#ifdef __AVX2__
+        return accumulateBlockAVX2 ( l, R, t, begin, end, ne );
+#else
+        return begin;
+#endif
+    }
+
+#ifdef __AVX2__
+    int accumulateBlockAVX2 ( int l, const Eigen::Matrix3f& R, const Eigen::Vector3f& t, int begin, int end, NormalEquations& ne ) const
+    {
+        const Level& level = levels_[l];
+        const ImageLevel& image = pyramid_[l];
+        const __m256 r00 = _mm256_set1_ps ( R ( 0,0 ) ), r01 = _mm256_set1_ps ( R ( 0,1 ) ), r02 = _mm256_set1_ps ( R ( 0,2 ) );
+        const __m256 r10 = _mm256_set1_ps ( R ( 1,0 ) ), r11 = _mm256_set1_ps ( R ( 1,1 ) ), r12 = _mm256_set1_ps ( R ( 1,2 ) );
+        const __m256 r20 = _mm256_set1_ps ( R ( 2,0 ) ), r21 = _mm256_set1_ps ( R ( 2,1 ) ), r22 = _mm256_set1_ps ( R ( 2,2 ) );
+        const __m256 t0 = _mm256_set1_ps ( t[0] ), t1 = _mm256_set1_ps ( t[1] ), t2 = _mm256_set1_ps ( t[2] );
+        const __m256 fx = _mm256_set1_ps ( image.fx ), fy = _mm256_set1_ps ( image.fy );
+        const __m256 cx = _mm256_set1_ps ( image.cx ), cy = _mm256_set1_ps ( image.cy );
+        const __m256 one = _mm256_set1_ps ( 1.0f ), zero = _mm256_setzero_ps();
+        const __m256 umax = _mm256_set1_ps ( image.gray.cols-2 ), vmax = _mm256_set1_ps ( image.gray.rows-2 );
+        const __m256 k = _mm256_set1_ps ( options_.huber );
+        const __m256 sign_mask = _mm256_set1_ps ( -0.0f );
+        const __m256i byte_mask = _mm256_set1_epi32 ( 0xff );
+        const __m256i step = _mm256_set1_epi32 ( image.gray.step );
+        const int* data = reinterpret_cast<const int*> ( image.gray.data );
+
+        __m256 b[6], cost = zero, count = zero;
+        for ( int j=0; j<6; j++ ) b[j] = zero;
+        alignas ( 32 ) float weights[8];
+
+        int i = begin;
+        for ( ; i+8<=end; i+=8 )
+        {
+            __m256 px = _mm256_loadu_ps ( &level.x[i] ), py = _mm256_loadu_ps ( &level.y[i] ), pz = _mm256_loadu_ps ( &level.z[i] );
+            __m256 X = _mm256_fmadd_ps ( r00, px, _mm256_fmadd_ps ( r01, py, _mm256_fmadd_ps ( r02, pz, t0 ) ) );
+            __m256 Y = _mm256_fmadd_ps ( r10, px, _mm256_fmadd_ps ( r11, py, _mm256_fmadd_ps ( r12, pz, t1 ) ) );
+            __m256 Z = _mm256_fmadd_ps ( r20, px, _mm256_fmadd_ps ( r21, py, _mm256_fmadd_ps ( r22, pz, t2 ) ) );
+            __m256 invz = _mm256_div_ps ( one, Z );
+            __m256 u = _mm256_fmadd_ps ( _mm256_mul_ps ( fx, X ), invz, cx );
+            __m256 v = _mm256_fmadd_ps ( _mm256_mul_ps ( fy, Y ), invz, cy );
+
+            __m256 valid = _mm256_cmp_ps ( Z, zero, _CMP_GT_OQ );
+            valid = _mm256_and_ps ( valid, _mm256_cmp_ps ( u, one, _CMP_GE_OQ ) );
+            valid = _mm256_and_ps ( valid, _mm256_cmp_ps ( v, one, _CMP_GE_OQ ) );
+            valid = _mm256_and_ps ( valid, _mm256_cmp_ps ( u, umax, _CMP_LT_OQ ) );
+            valid = _mm256_and_ps ( valid, _mm256_cmp_ps ( v, vmax, _CMP_LT_OQ ) );
+            u = _mm256_blendv_ps ( one, u, valid );
+            v = _mm256_blendv_ps ( one, v, valid );
+
+            // 只需当前图的灰度，不再采样梯度
+            __m256i x0 = _mm256_cvttps_epi32 ( u ), y0 = _mm256_cvttps_epi32 ( v );
+            __m256 fu = _mm256_sub_ps ( u, _mm256_cvtepi32_ps ( x0 ) );
+            __m256 fv = _mm256_sub_ps ( v, _mm256_cvtepi32_ps ( y0 ) );
+            __m256 w11 = _mm256_mul_ps ( fu, fv );
+            __m256 w10 = _mm256_sub_ps ( fv, w11 );
+            __m256 w01 = _mm256_sub_ps ( fu, w11 );
+            __m256 w00 = _mm256_sub_ps ( _mm256_sub_ps ( one, fu ), w10 );
+            __m256i idx = _mm256_add_epi32 ( _mm256_mullo_epi32 ( y0, step ), x0 );
+            __m256i top = _mm256_i32gather_epi32 ( data, idx, 1 );
+            __m256i bottom = _mm256_i32gather_epi32 ( data, _mm256_add_epi32 ( idx, step ), 1 );
+            __m256 I = _mm256_fmadd_ps ( w00, _mm256_cvtepi32_ps ( _mm256_and_si256 ( top, byte_mask ) ),
+                       _mm256_fmadd_ps ( w01, _mm256_cvtepi32_ps ( _mm256_and_si256 ( _mm256_srli_epi32 ( top, 8 ), byte_mask ) ),
+                       _mm256_fmadd_ps ( w10, _mm256_cvtepi32_ps ( _mm256_and_si256 ( bottom, byte_mask ) ),
+                       _mm256_mul_ps ( w11, _mm256_cvtepi32_ps ( _mm256_and_si256 ( _mm256_srli_epi32 ( bottom, 8 ), byte_mask ) ) ) ) ) );
+
+            __m256 e = _mm256_sub_ps ( I, _mm256_loadu_ps ( &level.ref[i] ) );
+            __m256 ae = _mm256_andnot_ps ( sign_mask, e );
+            __m256 inlier = _mm256_cmp_ps ( ae, k, _CMP_LE_OQ );
+            __m256 w = _mm256_blendv_ps ( _mm256_div_ps ( k, ae ), one, inlier );
+            w = _mm256_and_ps ( w, valid );
+            e = _mm256_and_ps ( e, valid );
+            __m256 c = _mm256_blendv_ps ( _mm256_mul_ps ( k, _mm256_sub_ps ( _mm256_add_ps ( ae, ae ), k ) ), _mm256_mul_ps ( e, e ), inlier );
+            cost = _mm256_add_ps ( cost, _mm256_and_ps ( c, valid ) );
+            count = _mm256_add_ps ( count, _mm256_and_ps ( one, valid ) );
+
+            __m256 we = _mm256_mul_ps ( w, e );
+            for ( int a=0; a<6; a++ )
+                b[a] = _mm256_fmadd_ps ( we, _mm256_loadu_ps ( &level.J[a][i] ), b[a] );
+
+            // 越界或降权的点很少，逐个从 H 中扣除
+            int reduced = _mm256_movemask_ps ( _mm256_cmp_ps ( w, one, _CMP_LT_OQ ) );
+            if ( reduced )
+            {
+                _mm256_store_ps ( weights, w );
+                for ( int j=0; j<8; j++ )
+                    if ( reduced & ( 1<<j ) )
+                        removeFromHessian ( level, i+j, 1.0f-weights[j], ne );
+            }
+        }
+
+        for ( int j=0; j<6; j++ ) ne.b[j] += hsum ( b[j] );
+        ne.cost += hsum ( cost );
+        ne.count += int ( hsum ( count ) );
+        return i;
+    }
+#endif
+
+    float fx_, fy_, cx_, cy_;
+    Options options_;
+    Eigen::Isometry3d T_ref_w_;
+    std::vector<Level> levels_;
+    ImagePyramid pyramid_;
+
+    int total_iterations_ = 0;
+    double last_cost_ = 0;
+    int num_valid_ = 0;
+};
+
+typedef InverseCompositionalTrackerT<float> InverseCompositionalTracker;
+
+#endif // DIRECT_TRACKER_IC_H
@@ -0,0 +1,183 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <string>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include "direct_tracker.h"
+#include "direct_tracker_ic.h"
+#include "pixel_selector.h"
+#include "photometric_ba.h"
+
+using namespace std;
+
+// 前端用直接法跟踪参考关键帧，运动足够大时插入关键帧；
+// 后端线程对最近几个关键帧做滑动窗口光度 BA，优化后的位姿和深度再作为前端的参考
+// 输出整个序列的 TUM 格式轨迹
+
+// 每一帧相对其参考关键帧的位姿，最后用关键帧的优化结果恢复全局位姿
+struct FrameRecord
+{
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    string timestamp;
+    int ref_id;
+    Eigen::Isometry3d T_cur_ref;
+};
+
+int main ( int argc, char** argv )
+{
+    if ( argc < 2 )
+    {
+        cout<<"usage: direct_window path_to_dataset [trajectory_file]"<<endl;
+        return 1;
+    }
+    string path_to_dataset = argv[1];
+    string trajectory_file = argc > 2 ? argv[2] : "trajectory.txt";
+
+    ifstream fin ( path_to_dataset + "/associate.txt" );
+    if ( !fin )
+    {
+        cout<<"please generate the associate file called associate.txt!"<<endl;
+        return 1;
+    }
+
+    // 相机内参
+    float cx = 325.5;
+    float cy = 253.5;
+    float fx = 518.0;
+    float fy = 519.0;
+    float depth_scale = 1000.0;
+
+    // 关键帧选取条件
+    const double keyframe_translation = 0.10;
+    const double keyframe_rotation = 0.15;
+    const double keyframe_valid_ratio = 0.6;
+
+    PixelSelector::Options selector_options;
+    selector_options.cell = 32;
+    selector_options.per_cell = 8;
+    PixelSelector selector ( fx, fy, cx, cy, depth_scale, selector_options );
+    InverseCompositionalTracker tracker ( fx, fy, cx, cy );
+    DirectBackend backend ( fx, fy, cx, cy );
+
+    vector<FrameRecord, Eigen::aligned_allocator<FrameRecord>> frames;
+    Eigen::Isometry3d Tcw = Eigen::Isometry3d::Identity();
+    Eigen::Isometry3d T_ref_w = Eigen::Isometry3d::Identity();     // 当前参考关键帧的位姿
+    int ref_id = -1, next_id = 0;
+    size_t ref_points = 0;
+    DirectBackend::State::Ptr used_state;
+    double time_tracking = 0;
+    int failed = 0;
+
+    string rgb_file, depth_file, time_rgb, time_depth;
+    cv::Mat color, depth, gray;
+    while ( fin>>time_rgb>>rgb_file>>time_depth>>depth_file )
+    {
+        color = cv::imread ( path_to_dataset+"/"+rgb_file );
+        depth = cv::imread ( path_to_dataset+"/"+depth_file, -1 );
+        if ( color.data==nullptr || depth.data==nullptr )
+            continue;
+        cv::cvtColor ( color, gray, cv::COLOR_BGR2GRAY );
+
+        chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+        bool need_keyframe = ref_id < 0;
+        if ( ref_id >= 0 )
+        {
+            // 后端优化过当前参考关键帧后，换用优化后的位姿和深度作为参考
+            DirectBackend::State::Ptr state = backend.state();
+            if ( state && state != used_state && state->newest_id == ref_id )
+            {
+                tracker.setReference ( state->newest_points, state->newest_gray, state->newest_Tcw );
+                Tcw = Tcw * T_ref_w.inverse() * state->newest_Tcw;
+                T_ref_w = state->newest_Tcw;
+                used_state = state;
+            }
+
+            Eigen::Isometry3d T_prev = Tcw;
+            if ( !tracker.track ( gray, Tcw ) )
+            {
+                Tcw = T_prev;
+                failed++;
+                need_keyframe = true;
+            }
+            Eigen::Isometry3d T_cur_ref = Tcw * T_ref_w.inverse();
+            if ( T_cur_ref.translation().norm() > keyframe_translation
+                    || Eigen::AngleAxisd ( T_cur_ref.rotation() ).angle() > keyframe_rotation
+                    || tracker.numValid() < keyframe_valid_ratio * ref_points )
+                need_keyframe = true;
+        }
+
+        if ( need_keyframe )
+        {
+            WindowKeyFrame::Ptr keyframe ( new WindowKeyFrame );
+            keyframe->id = next_id++;
+            keyframe->image.build ( gray.clone(), 1, fx, fy, cx, cy );
+            depth.convertTo ( keyframe->depth, CV_32FC1, 1.0/depth_scale );
+            keyframe->Tcw = Tcw;
+            keyframe->ref_id = ref_id;
+            keyframe->T_kf_ref = Tcw * T_ref_w.inverse();
+
+            PointBuffer points;
+            vector<cv::Point> pixels;
+            selector.select ( gray, depth, points, &pixels );
+            for ( size_t i=0; i<pixels.size(); i++ )
+            {
+                keyframe->u.push_back ( pixels[i].x );
+                keyframe->v.push_back ( pixels[i].y );
+                keyframe->gray.push_back ( points.gray[i] );
+                keyframe->idepth.push_back ( 1.0/points.z[i] );
+                keyframe->idepth0.push_back ( 1.0/points.z[i] );
+            }
+            // 在后端结果返回之前，先用深度图的点跟踪新关键帧
+            keyframe->worldPoints ( fx, fy, cx, cy, points );
+            tracker.setReference ( points, gray, Tcw );
+            ref_points = points.size();
+            ref_id = keyframe->id;
+            T_ref_w = Tcw;
+            backend.addKeyFrame ( keyframe );
+        }
+        chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+        time_tracking += chrono::duration_cast<chrono::duration<double>> ( t2-t1 ).count();
+
+        FrameRecord record;
+        record.timestamp = time_rgb;
+        record.ref_id = ref_id;
+        record.T_cur_ref = Tcw * T_ref_w.inverse();
+        frames.push_back ( record );
+    }
+    backend.finish();
+
+    // 用关键帧的最终位姿恢复每一帧的位姿，按 TUM 格式输出 Twc
+    PoseMap poses = backend.poses();
+    ofstream fout ( trajectory_file );
+    int missing = 0;
+    for ( const FrameRecord& record : frames )
+    {
+        PoseMap::const_iterator ref = poses.find ( record.ref_id );
+        if ( ref == poses.end() )    // 参考关键帧没有位姿，跳过该帧
+        {
+            missing++;
+            continue;
+        }
+        Eigen::Isometry3d Twc = ( record.T_cur_ref * ref->second ).inverse();
+        Eigen::Quaterniond q ( Twc.rotation() );
+        Eigen::Vector3d t = Twc.translation();
+        fout<<record.timestamp<<" "<<t[0]<<" "<<t[1]<<" "<<t[2]<<" "
+            <<q.x() <<" "<<q.y() <<" "<<q.z() <<" "<<q.w() <<endl;
+    }
+
+    if ( !frames.empty() )
+    {
+        cout<<frames.size() <<" frames, "<<next_id<<" key frames, "<<failed<<" tracking failures"<<endl;
+        if ( missing > 0 )
+            cout<<missing<<" frames skipped: their reference key frame has no pose"<<endl;
+        cout<<"front end: "<<time_tracking/frames.size() *1000<<" ms per frame"<<endl;
+        cout<<"back end: "<<backend.optimizations() <<" optimizations, "<<backend.averageTime() *1000<<" ms each"<<endl;
+        cout<<"trajectory saved to "<<trajectory_file<<endl;
+    }
+    return 0;
+}
@@ -0,0 +1,464 @@
+#ifndef PHOTOMETRIC_BA_H
+#define PHOTOMETRIC_BA_H
+
+#include <vector>
+#include <map>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <Eigen/Cholesky>
+
+#include "direct_tracker.h"
+
+// 滑动窗口光度 BA：联合优化窗口内若干关键帧的位姿与各点的逆深度
+// 每个点属于一个主导关键帧 (host)，在窗口内其他关键帧上产生光度残差；
+// 逆深度用 Schur 补逐点消去，只解位姿的稠密小方程，再回代求出逆深度
+// 最旧的关键帧位姿固定；RGB-D 深度作为逆深度的先验，同时约束尺度
+
+typedef std::map<int, Eigen::Isometry3d, std::less<int>,
+        Eigen::aligned_allocator<std::pair<const int, Eigen::Isometry3d>>> PoseMap;
+
+// 窗口中的关键帧，插入后只由后端线程修改位姿和逆深度
+struct WindowKeyFrame
+{
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    typedef std::shared_ptr<WindowKeyFrame> Ptr;
+
+    int id;
+    ImagePyramid image;             // 只用第 0 层的灰度与梯度
+    cv::Mat depth;                  // CV_32FC1 深度(米)，用于判断遮挡，可以为空
+    Eigen::Isometry3d Tcw;          // 前端的估计，进入窗口后由后端优化
+    int ref_id;                     // 前端跟踪时的参考关键帧，-1 表示没有
+    Eigen::Isometry3d T_kf_ref;     // 相对参考关键帧的位姿
+
+    // 主导点，各分量连续存放
+    std::vector<float> u, v;        // 像素坐标
+    std::vector<float> gray;        // 主导帧上的灰度
+    std::vector<double> idepth;     // 逆深度
+    std::vector<double> idepth0;    // 深度图给出的逆深度，作为先验
+
+    size_t size() const { return u.size(); }
+
+    // 当前估计下所有点的世界坐标
+    void worldPoints ( float fx, float fy, float cx, float cy, PointBuffer& points ) const
+    {
+        Eigen::Isometry3d Twc = Tcw.inverse();
+        points.clear();
+        points.reserve ( size() );
+        for ( size_t i=0; i<size(); i++ )
+        {
+            Eigen::Vector3d p ( ( u[i]-cx ) /fx, ( v[i]-cy ) /fy, 1 );
+            points.push_back ( Twc * ( p/idepth[i] ), gray[i] );
+        }
+    }
+};
+
+class PhotometricBA
+{
+public:
+    struct Options
+    {
+        int window;                 // 窗口内关键帧数
+        int iterations;             // 每次优化的 LM 迭代次数
+        float huber;                // Huber 核阈值(灰度)
+        float outlier;              // 灰度误差超过该值的残差视为外点，不参与优化
+        float occlusion;            // 投影深度与目标帧深度图的相对差超过该值视为遮挡
+        double idepth_prior;        // 逆深度先验的权重
+        double min_idepth;          // 逆深度下限
+
+        Options() : window ( 5 ), iterations ( 6 ), huber ( 10.0f ), outlier ( 40.0f ), occlusion ( 0.05f ), idepth_prior ( 1e6 ), min_idepth ( 1e-2 ) {}
+    };
+
+    PhotometricBA ( float fx, float fy, float cx, float cy, const Options& options = Options() )
+        : fx_ ( fx ), fy_ ( fy ), cx_ ( cx ), cy_ ( cy ), options_ ( options ) {}
+
+    const Options& options() const { return options_; }
+
+    // 优化窗口 (按时间从旧到新)，返回最终的平均代价
+    double optimize ( std::vector<WindowKeyFrame::Ptr>& window )
+    {
+        const int num_frames = window.size();
+        iterations_ = 0;
+        if ( num_frames < 2 )
+            return 0;
+
+        // 所有点展开成 (关键帧, 点) 的列表，便于并行
+        points_.clear();
+        for ( int k=0; k<num_frames; k++ )
+            for ( size_t i=0; i<window[k]->size(); i++ )
+                points_.push_back ( std::make_pair ( k, int ( i ) ) );
+        const int n = points_.size();
+        const int dim = 6*num_frames;
+        Hpr_.resize ( dim, n );
+        Hrr_.resize ( n );
+        br_.resize ( n );
+
+        double lambda = 1e-3;
+        Eigen::MatrixXd Hs;
+        Eigen::VectorXd bs;
+        double cost = linearize ( window, lambda, Hs, bs );
+        for ( int it=0; it<options_.iterations; it++ )
+        {
+            iterations_++;
+            // 固定最旧的关键帧，只解其余位姿
+            const int m = dim-6;
+            Eigen::MatrixXd A = Hs.bottomRightCorner ( m, m );
+            A.diagonal() *= 1+lambda;
+            Eigen::VectorXd dx = Eigen::VectorXd::Zero ( dim );
+            dx.tail ( m ) = A.ldlt().solve ( -bs.tail ( m ) );
+            if ( !dx.allFinite() )
+                break;
+
+            // 保存当前状态，代价上升时退回
+            std::vector<Eigen::Isometry3d, Eigen::aligned_allocator<Eigen::Isometry3d>> poses;
+            std::vector<std::vector<double>> idepths;
+            for ( int k=0; k<num_frames; k++ )
+            {
+                poses.push_back ( window[k]->Tcw );
+                idepths.push_back ( window[k]->idepth );
+            }
+
+            for ( int k=1; k<num_frames; k++ )
+                window[k]->Tcw = se3Exp ( dx.segment<6> ( 6*k ) ) * window[k]->Tcw;
+            #pragma omp parallel for schedule(static)
+            for ( int j=0; j<n; j++ )
+            {
+                if ( Hrr_[j] <= 0 )
+                    continue;
+                double& rho = window[points_[j].first]->idepth[points_[j].second];
+                double drho = - ( br_[j] + Hpr_.col ( j ).dot ( dx ) ) / Hrr_[j];
+                rho = std::max ( rho+drho, options_.min_idepth );
+            }
+
+            Eigen::MatrixXd Hs_new;
+            Eigen::VectorXd bs_new;
+            double new_cost = linearize ( window, lambda*0.5, Hs_new, bs_new );
+            if ( new_cost < cost )
+            {
+                lambda *= 0.5;
+                cost = new_cost;
+                Hs.swap ( Hs_new );
+                bs.swap ( bs_new );
+                if ( dx.norm() < 1e-6 )
+                    break;
+            }
+            else
+            {
+                for ( int k=0; k<num_frames; k++ )
+                {
+                    window[k]->Tcw = poses[k];
+                    window[k]->idepth.swap ( idepths[k] );
+                }
+                lambda *= 4;
+                cost = linearize ( window, lambda, Hs, bs );
+            }
+        }
+        return cost;
+    }
+
+    int iterations() const { return iterations_; }
+    int numResiduals() const { return num_residuals_; }
+
+private:
+    // 在当前估计处线性化，逐点消去逆深度，得到位姿的 Schur 补 Hs*dx = -bs
+    // 每个点的 H_pr, H_rr, b_r 保存下来用于回代；返回平均代价
+    double linearize ( const std::vector<WindowKeyFrame::Ptr>& window, double lambda, Eigen::MatrixXd& Hs, Eigen::VectorXd& bs )
+    {
+        const int num_frames = window.size();
+        const int dim = 6*num_frames;
+        const int n = points_.size();
+        const double k = options_.huber;
+        const double outlier_cost = k* ( 2*options_.outlier-k );
+
+        // 主导帧到目标帧的相对位姿 T_th = T_t * T_h^-1
+        std::vector<Eigen::Isometry3d, Eigen::aligned_allocator<Eigen::Isometry3d>> relative ( num_frames*num_frames );
+        for ( int h=0; h<num_frames; h++ )
+            for ( int t=0; t<num_frames; t++ )
+                relative[t*num_frames+h] = window[t]->Tcw * window[h]->Tcw.inverse();
+
+        Hs.setZero ( dim, dim );
+        bs.setZero ( dim );
+        double cost = 0;
+        int count = 0;
+        #pragma omp parallel
+        {
+            Eigen::MatrixXd H = Eigen::MatrixXd::Zero ( dim, dim );
+            Eigen::VectorXd b = Eigen::VectorXd::Zero ( dim );
+            double local_cost = 0;
+            int local_count = 0;
+            std::vector<int> observed;
+            #pragma omp for schedule(dynamic, 64) nowait
+            for ( int j=0; j<n; j++ )
+            {
+                const int h = points_[j].first;
+                const WindowKeyFrame& host = *window[h];
+                const int i = points_[j].second;
+                const double rho = host.idepth[i];
+                const Eigen::Vector3d ph = Eigen::Vector3d ( ( host.u[i]-cx_ ) /fx_, ( host.v[i]-cy_ ) /fy_, 1 ) / rho;
+
+                Eigen::MatrixXd::ColXpr Hpr = Hpr_.col ( j );
+                Hpr.setZero();
+                // 深度先验
+                double prior_e = rho - host.idepth0[i];
+                double Hrr = options_.idepth_prior;
+                double br = options_.idepth_prior * prior_e;
+                local_cost += options_.idepth_prior * prior_e * prior_e;
+
+                observed.clear();
+                observed.push_back ( h );
+                for ( int t=0; t<num_frames; t++ )
+                {
+                    if ( t==h )
+                        continue;
+                    const ImageLevel& target = window[t]->image[0];
+                    const Eigen::Isometry3d& T_th = relative[t*num_frames+h];
+                    Eigen::Vector3d pt = T_th * ph;
+                    if ( pt[2] <= 0 )
+                        continue;
+                    double u = fx_*pt[0]/pt[2] + cx_;
+                    double v = fy_*pt[1]/pt[2] + cy_;
+                    if ( u<1 || v<1 || u>=target.gray.cols-2 || v>=target.gray.rows-2 )
+                        continue;
+                    int x0 = int ( u ), y0 = int ( v );
+                    double fu = u-x0, fv = v-y0;
+                    if ( !window[t]->depth.empty() )
+                    {
+                        // 目标帧在该像素测得的深度与投影深度不符，该点被遮挡或不可靠
+                        float d = window[t]->depth.ptr<float> ( int ( v+0.5 ) ) [int ( u+0.5 )];
+                        if ( d > 0 && std::fabs ( d-pt[2] ) > options_.occlusion*pt[2] )
+                            continue;
+                    }
+                    double e = bilinear ( target.gray, u, v ) - host.gray[i];
+                    double gx = bilinear ( target.gx, x0, y0, fu, fv );
+                    double gy = bilinear ( target.gy, x0, y0, fu, fv );
+
+                    // 灰度对目标帧相机坐标的导数
+                    double invz = 1.0/pt[2];
+                    Eigen::Vector3d g ( gx*fx_*invz, gy*fy_*invz, - ( gx*fx_*pt[0] + gy*fy_*pt[1] ) *invz*invz );
+                    Eigen::Matrix<double,6,1> Jt, Jh;
+                    Jt.head<3>() = pt.cross ( g );
+                    Jt.tail<3>() = g;
+                    Eigen::Vector3d gh = T_th.linear().transpose() * g;
+                    Jh.head<3>() = -ph.cross ( gh );
+                    Jh.tail<3>() = -gh;
+                    double Jr = -gh.dot ( ph ) / rho;
+
+                    // 外点只计入固定的代价，保证不同迭代的平均代价可比
+                    double ae = std::fabs ( e );
+                    local_count++;
+                    if ( ae > options_.outlier )
+                    {
+                        local_cost += outlier_cost;
+                        continue;
+                    }
+                    double w = ae<=k ? 1.0 : k/ae;
+                    local_cost += ae<=k ? e*e : k* ( 2*ae-k );
+                    observed.push_back ( t );
+
+                    // 只累加上三角的块，最后再对称化
+                    H.block<6,6> ( 6*h, 6*h ) += w*Jh*Jh.transpose();
+                    H.block<6,6> ( 6*t, 6*t ) += w*Jt*Jt.transpose();
+                    if ( h<t )
+                        H.block<6,6> ( 6*h, 6*t ) += w*Jh*Jt.transpose();
+                    else
+                        H.block<6,6> ( 6*t, 6*h ) += w*Jt*Jh.transpose();
+                    b.segment<6> ( 6*h ) += w*e*Jh;
+                    b.segment<6> ( 6*t ) += w*e*Jt;
+                    Hpr.segment<6> ( 6*h ) += w*Jr*Jh;
+                    Hpr.segment<6> ( 6*t ) += w*Jr*Jt;
+                    Hrr += w*Jr*Jr;
+                    br += w*Jr*e;
+                }
+
+                // 消去逆深度：Hs -= H_pr * H_rr^-1 * H_rp, bs -= H_pr * H_rr^-1 * b_r
+                // H_pr 只在主导帧和观测到该点的帧上非零，按块更新
+                Hrr *= 1+lambda;
+                Hrr_[j] = Hrr;
+                br_[j] = br;
+                std::sort ( observed.begin(), observed.end() );
+                for ( size_t a=0; a<observed.size(); a++ )
+                {
+                    Eigen::Matrix<double,6,1> Ha = Hpr.segment<6> ( 6*observed[a] ) / Hrr;
+                    for ( size_t c=a; c<observed.size(); c++ )
+                        H.block<6,6> ( 6*observed[a], 6*observed[c] ) -= Ha * Hpr.segment<6> ( 6*observed[c] ).transpose();
+                    b.segment<6> ( 6*observed[a] ) -= Ha * br;
+                }
+            }
+            #pragma omp critical
+            {
+                Hs += H;
+                bs += b;
+                cost += local_cost;
+                count += local_count;
+            }
+        }
+        // 只累加了上三角
+        Hs.triangularView<Eigen::StrictlyLower>() = Hs.transpose();
+        num_residuals_ = count;
+        return count > 0 ? cost/count : 0;
+    }
+
+    float fx_, fy_, cx_, cy_;
+    Options options_;
+
+    // 每次优化时重建
+    std::vector<std::pair<int,int>> points_;    // (窗口内下标, 点下标)
+    Eigen::MatrixXd Hpr_;                       // 每列为一个点的 H_pr
+    std::vector<double> Hrr_, br_;
+
+    int iterations_ = 0;
+    int num_residuals_ = 0;
+};
+
+// 后端线程：前端插入关键帧后立即返回，后端把新关键帧加入窗口并做光度 BA，
+// 优化结果以快照形式发布，前端在下一帧开始时取用
+class DirectBackend
+{
+public:
+    // 最近一次优化后最新关键帧的状态，前端据此更新跟踪的参考
+    struct State
+    {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+        typedef std::shared_ptr<const State> Ptr;
+
+        int newest_id;
+        Eigen::Isometry3d newest_Tcw;
+        cv::Mat newest_gray;
+        PointBuffer newest_points;      // 世界坐标
+        double cost;
+        int iterations;
+    };
+
+    DirectBackend ( float fx, float fy, float cx, float cy, const PhotometricBA::Options& options = PhotometricBA::Options() )
+        : fx_ ( fx ), fy_ ( fy ), cx_ ( cx ), cy_ ( cy ), ba_ ( fx, fy, cx, cy, options ),
+          busy_ ( false ), stop_ ( false ), optimizations_ ( 0 ), time_ ( 0 )
+    {
+        thread_ = std::thread ( &DirectBackend::run, this );
+    }
+
+    ~DirectBackend()
+    {
+        {
+            std::lock_guard<std::mutex> lock ( mutex_ );
+            stop_ = true;
+        }
+        cond_.notify_all();
+        thread_.join();
+    }
+
+    // 前端调用：交出关键帧，此后前端不再修改它
+    void addKeyFrame ( const WindowKeyFrame::Ptr& keyframe )
+    {
+        {
+            std::lock_guard<std::mutex> lock ( mutex_ );
+            pending_.push_back ( keyframe );
+        }
+        cond_.notify_all();
+    }
+
+    State::Ptr state() const
+    {
+        std::lock_guard<std::mutex> lock ( mutex_ );
+        return state_;
+    }
+
+    // 等待所有已提交的关键帧处理完
+    void finish()
+    {
+        std::unique_lock<std::mutex> lock ( mutex_ );
+        cond_.wait ( lock, [this] { return pending_.empty() && !busy_; } );
+    }
+
+    // 所有关键帧的最新位姿 (已移出窗口的为最后一次优化的结果)
+    PoseMap poses() const
+    {
+        std::lock_guard<std::mutex> lock ( mutex_ );
+        return poses_;
+    }
+
+    int optimizations() const { std::lock_guard<std::mutex> lock ( mutex_ ); return optimizations_; }
+    double averageTime() const { std::lock_guard<std::mutex> lock ( mutex_ ); return optimizations_ ? time_/optimizations_ : 0; }
+
+private:
+    void run()
+    {
+        for ( ;; )
+        {
+            std::deque<WindowKeyFrame::Ptr> incoming;
+            {
+                std::unique_lock<std::mutex> lock ( mutex_ );
+                cond_.wait ( lock, [this] { return !pending_.empty() || stop_; } );
+                if ( stop_ )
+                    break;
+                incoming.swap ( pending_ );
+                busy_ = true;
+            }
+
+            // 新关键帧的初值：参考关键帧的最新位姿乘上前端测得的相对运动。
+            // 初值先写入 poses_，这样同一批中后面的关键帧能找到参考位姿，裁窗口时被挤出的关键帧也有位姿
+            for ( const WindowKeyFrame::Ptr& kf : incoming )
+            {
+                {
+                    std::lock_guard<std::mutex> lock ( mutex_ );
+                    if ( kf->ref_id >= 0 )
+                    {
+                        PoseMap::const_iterator ref = poses_.find ( kf->ref_id );
+                        if ( ref != poses_.end() )
+                            kf->Tcw = kf->T_kf_ref * ref->second;
+                    }
+                    poses_[kf->id] = kf->Tcw;
+                }
+                window_.push_back ( kf );
+            }
+            while ( int ( window_.size() ) > ba_.options().window )
+                window_.erase ( window_.begin() );
+
+            std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+            double cost = ba_.optimize ( window_ );
+            std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+            State* state = new State;
+            const WindowKeyFrame& newest = *window_.back();
+            state->newest_id = newest.id;
+            state->newest_Tcw = newest.Tcw;
+            state->newest_gray = newest.image[0].gray;
+            newest.worldPoints ( fx_, fy_, cx_, cy_, state->newest_points );
+            state->cost = cost;
+            state->iterations = ba_.iterations();
+
+            {
+                std::lock_guard<std::mutex> lock ( mutex_ );
+                for ( const WindowKeyFrame::Ptr& kf : window_ )
+                    poses_[kf->id] = kf->Tcw;
+                state_ = State::Ptr ( state );
+                optimizations_++;
+                time_ += std::chrono::duration_cast<std::chrono::duration<double>> ( t2-t1 ).count();
+                busy_ = false;
+            }
+            cond_.notify_all();
+        }
+    }
+
+    float fx_, fy_, cx_, cy_;
+    PhotometricBA ba_;
+    std::vector<WindowKeyFrame::Ptr> window_;   // 只由后端线程访问
+
+    mutable std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<WindowKeyFrame::Ptr> pending_;
+    bool busy_;
+    bool stop_;
+    State::Ptr state_;
+    PoseMap poses_;
+    int optimizations_;
+    double time_;
+    std::thread thread_;
+};
+
+#endif // PHOTOMETRIC_BA_H
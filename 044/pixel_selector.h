@@ -0,0 +1,175 @@
+#ifndef PIXEL_SELECTOR_H
+#define PIXEL_SELECTOR_H
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+
+#include <opencv2/core/core.hpp>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "direct_tracker.h"
+
+// 半稠密直接法的选点：按网格分块，每格只保留梯度最大的若干个有深度的像素，
+// 点数上限为 格子数*每格预算，与场景纹理多少无关
+// 梯度平方和逐行计算(AVX2 一次 8 个像素)，各格子的选点与反投影都用 OpenMP 并行
+class PixelSelector
+{
+public:
+    struct Options
+    {
+        int cell;               // 格子边长(像素)
+        int per_cell;           // 每格最多保留的点数
+        int min_gradient;       // 梯度阈值，与原来的 delta.norm() >= 50 含义相同
+        int border;             // 图像边缘不选点的宽度
+        float max_depth_jump;   // 与上下左右像素的相对深度差超过该值视为遮挡边缘，不选
+
+        Options() : cell ( 16 ), per_cell ( 32 ), min_gradient ( 50 ), border ( 10 ), max_depth_jump ( 0.05f ) {}
+    };
+
+    PixelSelector ( float fx, float fy, float cx, float cy, float depth_scale, const Options& options = Options() )
+        : fx_ ( fx ), fy_ ( fy ), cx_ ( cx ), cy_ ( cy ), depth_scale_ ( depth_scale ), options_ ( options ) {}
+
+    // 从灰度图和深度图 (CV_16UC1) 中选点，反投影到相机坐标系后写入 points (会先清空)
+    // pixels 不为空时同时输出所选像素的坐标，顺序与 points 一致
+    void select ( const cv::Mat& gray, const cv::Mat& depth, PointBuffer& points, std::vector<cv::Point>* pixels = nullptr )
+    {
+        computeScore ( gray );
+
+        const int border = std::max ( options_.border, 1 );
+        const int grid_cols = ( gray.cols + options_.cell - 1 ) / options_.cell;
+        const int grid_rows = ( gray.rows + options_.cell - 1 ) / options_.cell;
+        const int num_cells = grid_cols * grid_rows;
+        const int threshold = options_.min_gradient * options_.min_gradient;
+        selected_.resize ( num_cells );
+        offsets_.resize ( num_cells + 1 );
+
+        // 每个格子独立挑选，候选数组每个线程复用
+        #pragma omp parallel
+        {
+            std::vector<std::pair<int,int>> candidates;     // (梯度平方和, 像素下标)
+            candidates.reserve ( options_.cell * options_.cell );
+            #pragma omp for schedule(dynamic, 4)
+            for ( int c=0; c<num_cells; c++ )
+            {
+                int x0 = std::max ( c % grid_cols * options_.cell, border );
+                int y0 = std::max ( c / grid_cols * options_.cell, border );
+                int x1 = std::min ( ( c % grid_cols + 1 ) * options_.cell, gray.cols - border );
+                int y1 = std::min ( ( c / grid_cols + 1 ) * options_.cell, gray.rows - border );
+                candidates.clear();
+                for ( int y=y0; y<y1; y++ )
+                {
+                    const int* score = score_.ptr<int> ( y );
+                    const ushort* d = depth.ptr<ushort> ( y );
+                    for ( int x=x0; x<x1; x++ )
+                        if ( score[x] >= threshold && d[x] != 0 && depthContinuous ( depth, x, y ) )
+                            candidates.push_back ( std::make_pair ( score[x], y*gray.cols + x ) );
+                }
+                if ( int ( candidates.size() ) > options_.per_cell )
+                {
+                    std::nth_element ( candidates.begin(), candidates.begin() + options_.per_cell, candidates.end(),
+                                       std::greater<std::pair<int,int>>() );
+                    candidates.resize ( options_.per_cell );
+                }
+                std::vector<int>& selected = selected_[c];
+                selected.clear();
+                for ( const std::pair<int,int>& candidate : candidates )
+                    selected.push_back ( candidate.second );
+                // 格内按行优先排序，保持输出确定且访存连续
+                std::sort ( selected.begin(), selected.end() );
+            }
+        }
+
+        offsets_[0] = 0;
+        for ( int c=0; c<num_cells; c++ )
+            offsets_[c+1] = offsets_[c] + selected_[c].size();
+        const int n = offsets_[num_cells];
+        points.resize ( n );
+        if ( pixels )
+            pixels->resize ( n );
+
+        // 反投影，各格子写入自己的区间
+        const float inv_fx = 1.0f/fx_, inv_fy = 1.0f/fy_, inv_scale = 1.0f/depth_scale_;
+        #pragma omp parallel for schedule(static)
+        for ( int c=0; c<num_cells; c++ )
+        {
+            int k = offsets_[c];
+            for ( int index : selected_[c] )
+            {
+                int x = index % gray.cols, y = index / gray.cols;
+                float z = depth.ptr<ushort> ( y ) [x] * inv_scale;
+                points.x[k] = ( x - cx_ ) * z * inv_fx;
+                points.y[k] = ( y - cy_ ) * z * inv_fy;
+                points.z[k] = z;
+                points.gray[k] = gray.ptr<uchar> ( y ) [x];
+                if ( pixels )
+                    ( *pixels ) [k] = cv::Point ( x, y );
+                k++;
+            }
+        }
+    }
+
+private:
+    // 深度在上下左右都连续：遮挡边缘上的点在其他视角下会被挡住或露出背景，深度也不可靠
+    bool depthContinuous ( const cv::Mat& depth, int x, int y ) const
+    {
+        const float d = depth.ptr<ushort> ( y ) [x];
+        const float jump = options_.max_depth_jump * d;
+        const ushort neighbors[4] = { depth.ptr<ushort> ( y ) [x-1], depth.ptr<ushort> ( y ) [x+1],
+                                      depth.ptr<ushort> ( y-1 ) [x], depth.ptr<ushort> ( y+1 ) [x] };
+        for ( int i=0; i<4; i++ )
+            if ( neighbors[i] == 0 || std::fabs ( neighbors[i] - d ) > jump )
+                return false;
+        return true;
+    }
+
+    // 每个像素中心差分的平方和 dx*dx+dy*dy，边界一圈为 0
+    void computeScore ( const cv::Mat& gray )
+    {
+        score_.create ( gray.rows, gray.cols, CV_32SC1 );
+        score_.setTo ( 0 );
+        const int cols = gray.cols;
+        #pragma omp parallel for schedule(static)
+        for ( int y=1; y<gray.rows-1; y++ )
+        {
+            const uchar* up = gray.ptr<uchar> ( y-1 );
+            const uchar* row = gray.ptr<uchar> ( y );
+            const uchar* down = gray.ptr<uchar> ( y+1 );
+            int* score = score_.ptr<int> ( y );
+            int x = 1;
+#ifdef __AVX2__
+            for ( ; x+8<cols; x+=8 )
+            {
+                __m256i left = _mm256_cvtepu8_epi32 ( _mm_loadl_epi64 ( reinterpret_cast<const __m128i*> ( row+x-1 ) ) );
+                __m256i right = _mm256_cvtepu8_epi32 ( _mm_loadl_epi64 ( reinterpret_cast<const __m128i*> ( row+x+1 ) ) );
+                __m256i top = _mm256_cvtepu8_epi32 ( _mm_loadl_epi64 ( reinterpret_cast<const __m128i*> ( up+x ) ) );
+                __m256i bottom = _mm256_cvtepu8_epi32 ( _mm_loadl_epi64 ( reinterpret_cast<const __m128i*> ( down+x ) ) );
+                __m256i dx = _mm256_sub_epi32 ( right, left );
+                __m256i dy = _mm256_sub_epi32 ( bottom, top );
+                __m256i s = _mm256_add_epi32 ( _mm256_mullo_epi32 ( dx, dx ), _mm256_mullo_epi32 ( dy, dy ) );
+                _mm256_storeu_si256 ( reinterpret_cast<__m256i*> ( score+x ), s );
+            }
+#endif
+            for ( ; x<cols-1; x++ )
+            {
+                int dx = int ( row[x+1] ) - int ( row[x-1] );
+                int dy = int ( down[x] ) - int ( up[x] );
+                score[x] = dx*dx + dy*dy;
+            }
+        }
+    }
+
+    float fx_, fy_, cx_, cy_, depth_scale_;
+    Options options_;
+
+    // 各帧复用的缓冲区
+    cv::Mat score_;                             // CV_32SC1 梯度平方和
+    std::vector<std::vector<int>> selected_;    // 每个格子选出的像素下标
+    std::vector<int> offsets_;                  // 每个格子在输出中的起始位置
+};
+
+#endif // PIXEL_SELECTOR_H
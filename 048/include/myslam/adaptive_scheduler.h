@@ -0,0 +1,47 @@
+#ifndef ADAPTIVE_SCHEDULER_H
+#define ADAPTIVE_SCHEDULER_H
+
+#include "myslam/common_include.h"
+#include "myslam/visual_odometry.h"
+
+namespace myslam
+{
+    // 按单帧时间预算在线调整 VO 的计算量
+    // 特征相关阶段(提取、描述子、匹配)超时则减少特征数与金字塔层数，
+    // 位姿阶段超时则减少 RANSAC 与 g2o 迭代次数；耗时回落后逐级恢复
+    class AdaptiveScheduler
+    {
+    public:
+        typedef shared_ptr<AdaptiveScheduler> Ptr;
+        static const int MAX_LEVEL = 6;     // 最大降级档位
+
+        AdaptiveScheduler(VisualOdometry::Ptr vo, double frame_budget);
+
+        // 每帧 addFrame 之后调用，返回本帧是否超出预算
+        bool update();
+
+        bool degraded() const { return feature_level_ > 0 || pose_level_ > 0; }
+        int featureLevel() const { return feature_level_; }
+        int poseLevel() const { return pose_level_; }
+        double averageCost() const { return average_cost_; }
+
+        int over_budget_frames_;    // 超出预算的帧数
+        int degraded_frames_;       // 以降级参数运行的帧数
+
+    private:
+        void apply();   // 将档位换算成参数写入 VO
+
+        VisualOdometry::Ptr vo_;
+        double  budget_;            // 单帧预算(秒)
+        double  average_cost_;      // 单帧耗时的滑动平均
+        int     feature_level_;     // 特征阶段降级档位，0 为原始参数
+        int     pose_level_;        // 位姿阶段降级档位
+        int     cooldown_;          // 调整后等待若干帧再评估
+        int     calm_frames_;       // 连续远低于预算的帧数
+
+        // 配置文件中的原始参数
+        int nominal_features_, nominal_pyramid_, nominal_pnp_, nominal_optimize_;
+    };
+}
+
+#endif // ADAPTIVE_SCHEDULER_H
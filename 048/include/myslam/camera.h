@@ -2,6 +2,7 @@
 #define CAMERA_H
 
 #include "myslam/common_include.h"
+#include "myslam/config.h"
 
 namespace myslam
 {
@@ -12,7 +13,7 @@ namespace myslam
         typedef std::shared_ptr<Camera> Ptr;
         float   fx_, fy_, cx_, cy_, depth_scale_;  // 内参
 
-        Camera();   // 定义 Camera 的指针类型
+        Camera(Config::Ptr config);   // 从配置读取内参
         Camera(float fx, float fy, float cx, float cy, float depth_scale = 0) :
             fx_(fx), fy_(fy), cx_(cx), cy_(cy), depth_scale_(depth_scale)
         {}
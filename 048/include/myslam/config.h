@@ -5,24 +5,25 @@
 
 namespace myslam
 {
+    // 配置参数，每个 VO 实例持有自己的一份，可在同一进程中并存
     class Config
     {
     private:
-        static std::shared_ptr<Config> config_;
         cv::FileStorage file_;
 
         Config() {} 
     public:
+        typedef std::shared_ptr<Config> Ptr;
         ~Config();  
 
-        // 设置一个新的配置文件
-        static void setParameterFile(const std::string& filename);
+        // 读取配置文件，文件不存在时返回 nullptr
+        static Config::Ptr create(const std::string& filename);
 
         // 访问参数值
         template< typename T >
-        static T get(const std::string& key)
+        T get(const std::string& key) const
         {
-            return T(Config::config_->file_[key]);
+            return T(file_[key]);
         }
     };
 }
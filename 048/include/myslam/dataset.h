@@ -0,0 +1,26 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include "myslam/common_include.h"
+
+namespace myslam
+{
+    // TUM 数据集读取，读入 associate.txt 中的图像文件与时间戳
+    class Dataset
+    {
+    public:
+        typedef shared_ptr<Dataset> Ptr;
+        string          dataset_dir_;                  // 数据集目录
+        vector<string>  rgb_files_, depth_files_;      // 彩色图与深度图文件
+        vector<double>  rgb_times_, depth_times_;      // 对应的时间戳
+
+        Dataset(const string& dataset_dir) : dataset_dir_(dataset_dir) {}
+
+        // 读取 associate.txt，失败返回 false
+        bool load();
+
+        size_t size() const { return rgb_files_.size(); }
+    };
+}
+
+#endif // DATASET_H
@@ -11,13 +11,15 @@ namespace myslam
     {
     public:
         typedef std::shared_ptr<Frame> Ptr;
-        unsigned long                  id_;            // 帧的id
+        unsigned long                  id_;            // 帧的id，由处理它的 VO 实例分配
         double                         time_stamp_;    // 记录的时间
         SE3                            T_c_w_;         // 从世界到相机的转换
         Camera::Ptr                    camera_;        // 针孔/RGBD相机模型
         Mat                            color_, depth_; // 颜色和深度图像
 
         bool                           is_key_frame_;  // 是否关键帧
+        vector<cv::KeyPoint>           keypoints_;     // 关键帧的特征点，插入地图后不再修改
+        Mat                            descriptors_;   // 关键帧的描述子
 
     public: // 数据成员
         Frame();
@@ -0,0 +1,52 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include "myslam/common_include.h"
+#include "myslam/frame.h"
+
+#include <mutex>
+
+namespace myslam
+{
+    // Frame 对象池：循环使用 Frame 对象与预分配的图像缓冲区
+    // 帧释放后自动回到池中；成为关键帧的帧调用 promote() 转为自有内存
+    class FramePool : public std::enable_shared_from_this<FramePool>
+    {
+    public:
+        typedef shared_ptr<FramePool> Ptr;
+
+        // 预分配 capacity 组 rows x cols 的彩色图(CV_8UC3)与深度图(CV_16UC1)
+        FramePool(int rows, int cols, int capacity);
+        ~FramePool();
+
+        // 取出一帧，图像指向池中的缓冲区；池用尽时自动扩容
+        Frame::Ptr acquire();
+
+        // 将图像文件直接解码到帧的缓冲区，避免 imread 重新分配
+        bool readImages(Frame::Ptr frame, const string& color_file, const string& depth_file);
+
+        // 关键帧会被地图长期持有：拷贝图像到自有内存，立即归还缓冲区
+        void promote(Frame::Ptr frame);
+
+        int numBuffers();       // 已分配的缓冲区组数
+        int numFreeBuffers();   // 空闲的缓冲区组数
+
+    private:
+        struct Buffer
+        {
+            Mat color_, depth_;
+        };
+
+        int addBuffer();            // 新分配一组缓冲区，返回下标
+        void recycle(Frame* frame); // shared_ptr 的删除器，帧回到池中
+
+        std::mutex                  mutex_;
+        int                         rows_, cols_;
+        vector<Buffer>              buffers_;
+        vector<int>                 free_buffers_;  // 空闲缓冲区下标
+        unordered_map<Frame*, int>  frame_buffer_;  // 仍占用缓冲区的帧
+        vector<Frame*>              free_frames_;   // 可复用的 Frame 对象
+    };
+}
+
+#endif // FRAME_POOL_H
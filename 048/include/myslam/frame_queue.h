@@ -0,0 +1,80 @@
+#ifndef FRAME_QUEUE_H
+#define FRAME_QUEUE_H
+
+#include "myslam/common_include.h"
+#include "myslam/frame.h"
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+namespace myslam
+{
+    // 实时回放时钟：把帧时间戳换算为墙上时间
+    class ReplayClock
+    {
+    public:
+        ReplayClock(double rate = 1.0) : rate_(rate), start_time_(0), first_stamp_(0) {}
+
+        // 以当前时刻对齐第一帧的时间戳
+        void start(double first_stamp);
+        // 时间戳对应的墙上时刻(秒)
+        double due(double time_stamp) const;
+        // 睡眠到该时间戳应当到达的时刻
+        void waitUntil(double time_stamp) const;
+
+        static double now();   // 单调时钟(秒)
+
+    private:
+        double rate_;           // 回放倍速
+        double start_time_;     // 开始回放的墙上时刻
+        double first_stamp_;    // 第一帧时间戳
+    };
+
+    // 有界输入队列，过载时按策略丢帧，保证位姿延迟有界
+    class FrameQueue
+    {
+    public:
+        typedef shared_ptr<FrameQueue> Ptr;
+        enum OverloadPolicy {
+            DROP_OLDEST = 0,        // 丢弃最旧的帧
+            KEEP_LATEST,            // 只保留最新的一帧
+            PRIORITIZE_KEYFRAME     // 丢弃与上一处理帧最相似的帧，保留可能的关键帧
+        };
+
+        struct Item
+        {
+            Frame::Ptr  frame_;
+            double      arrival_;   // 到达时刻(墙上时间)
+            Mat         thumb_;     // 缩略灰度图，用于估计关键帧可能性
+        };
+
+        FrameQueue(size_t capacity, OverloadPolicy policy) :
+            capacity_(capacity > 0 ? capacity : 1), policy_(policy), closed_(false), pushed_(0), dropped_(0)
+        {}
+
+        // 放入一帧，从不阻塞；队列满时按策略丢帧
+        void push(Frame::Ptr frame, double arrival);
+        // 取出一帧，队列空时等待；关闭且为空时返回 false
+        bool pop(Item& item);
+        // 输入结束
+        void close();
+
+        long pushed();
+        long dropped();
+
+    private:
+        void dropOne();     // 按策略丢弃一帧，调用时已加锁
+
+        std::mutex              mutex_;
+        std::condition_variable cond_;
+        std::deque<Item>        items_;
+        size_t                  capacity_;
+        OverloadPolicy          policy_;
+        bool                    closed_;
+        Mat                     last_thumb_;    // 上一处理帧的缩略图
+        long                    pushed_, dropped_;
+    };
+}
+
+#endif // FRAME_QUEUE_H
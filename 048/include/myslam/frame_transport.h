@@ -0,0 +1,110 @@
+#ifndef FRAME_TRANSPORT_H
+#define FRAME_TRANSPORT_H
+
+#include "myslam/common_include.h"
+#include "myslam/frame.h"
+
+#include <atomic>
+#include <cstdint>
+
+namespace myslam
+{
+    // 共享内存段起始处的环形缓冲区头部
+    // 单生产者单消费者：生产者只写 write_index_，消费者只写 read_index_
+    struct FrameRingHeader
+    {
+        uint32_t    magic_;             // 校验字
+        uint32_t    num_slots_;         // 槽数量
+        int32_t     rows_, cols_;       // 图像尺寸
+        uint64_t    slot_size_;         // 每个槽的字节数
+        uint64_t    color_offset_;      // 槽内彩色图偏移
+        uint64_t    depth_offset_;      // 槽内深度图偏移
+
+        alignas(64) std::atomic<uint64_t> write_index_;    // 已发布的帧数
+        alignas(64) std::atomic<uint64_t> read_index_;     // 已释放的帧数
+        alignas(64) std::atomic<uint32_t> closed_;         // 生产者结束标志
+    };
+
+    // 每个槽的头部，紧跟其后是彩色图(CV_8UC3)与深度图(CV_16UC1)
+    struct FrameSlotHeader
+    {
+        uint64_t    sequence_;          // 帧序号
+        double      time_stamp_;        // 图像时间戳
+        double      publish_time_;      // 发布时刻(单调时钟，秒)
+    };
+
+    // 基于 POSIX 共享内存的 RGB-D 帧环形缓冲区
+    class FrameTransport
+    {
+    public:
+        typedef shared_ptr<FrameTransport> Ptr;
+
+        ~FrameTransport();
+
+        // 生产者：创建共享内存段，失败返回 nullptr；同名段已存在时失败，force 为 true 时先删除它
+        static FrameTransport::Ptr create(const string& name, int num_slots, int rows, int cols, bool force = false);
+        // 消费者：打开已存在的共享内存段，失败返回 nullptr
+        static FrameTransport::Ptr open(const string& name);
+
+        // 生产者接口：取得下一个空槽的图像头，缓冲区满时返回 false
+        bool beginWrite(Mat& color, Mat& depth);
+        void endWrite(double time_stamp);
+        void close();
+
+        // 消费者接口：取得最早的已发布槽，缓冲区空时返回 false
+        // 返回的图像直接指向共享内存，在 endRead() 之前有效
+        bool beginRead(Mat& color, Mat& depth, double& time_stamp, double& publish_time);
+        void endRead();
+
+        bool closed() const;
+        bool drained() const;   // 所有已发布的帧都已被消费者释放
+        int pending() const;    // 已发布但尚未被消费者释放的帧数
+        int rows() const { return header_->rows_; }
+        int cols() const { return header_->cols_; }
+        int numSlots() const { return header_->num_slots_; }
+
+        // 单调时钟，生产者与消费者进程间可比较
+        static double now();
+
+    private:
+        FrameTransport() : base_(nullptr), size_(0), header_(nullptr), owner_(false) {}
+
+        FrameSlotHeader* slot(uint64_t index) const;
+        Mat colorOf(FrameSlotHeader* slot) const;
+        Mat depthOf(FrameSlotHeader* slot) const;
+
+        uint8_t*            base_;      // 映射地址
+        size_t              size_;      // 映射长度
+        FrameRingHeader*    header_;
+        string              name_;
+        bool                owner_;     // 生产者负责 unlink
+    };
+
+    // 从共享内存读取帧，图像以 cv::Mat 直接包裹槽内存，不做拷贝
+    class SharedMemoryFrameSource
+    {
+    public:
+        typedef shared_ptr<SharedMemoryFrameSource> Ptr;
+
+        SharedMemoryFrameSource(FrameTransport::Ptr transport, Camera::Ptr camera) :
+            transport_(transport), camera_(camera), latency_(0)
+        {}
+        ~SharedMemoryFrameSource();
+
+        // 阻塞直到取得下一帧；生产者结束且缓冲区为空时返回 nullptr
+        // 取新帧时释放上一帧的槽，上一帧若已成为关键帧则先拷贝到自有内存
+        Frame::Ptr grab();
+
+        double lastLatency() const { return latency_; }  // 发布到取得的延迟(秒)
+
+    private:
+        void releaseCurrent();
+
+        FrameTransport::Ptr transport_;
+        Camera::Ptr         camera_;
+        Frame::Ptr          current_;   // 正在占用槽的帧
+        double              latency_;
+    };
+}
+
+#endif // FRAME_TRANSPORT_H
@@ -0,0 +1,95 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <thread>
+
+#include "myslam/common_include.h"
+
+// 编译期日志级别：低于该级别的日志语句不参与编译，0 DEBUG, 1 INFO, 2 WARN, 3 ERROR, 4 OFF
+#ifndef MYSLAM_LOG_LEVEL
+#define MYSLAM_LOG_LEVEL 0
+#endif
+
+namespace myslam
+{
+    // 异步日志：调用线程只负责格式化并写入无锁环形队列，由后台线程输出到 stdout
+    class Logger
+    {
+    public:
+        enum Level { DEBUG=0, INFO, WARN, ERROR, OFF };
+
+        static const int MESSAGE_SIZE = 256;        // 单条日志最大长度，超出部分截断
+        static const int QUEUE_SIZE = 4096;         // 队列容量，必须是 2 的幂
+
+        static Logger& instance();
+        ~Logger();
+
+        // 运行期日志级别，可随时修改
+        void setLevel(int level) { level_.store(level, std::memory_order_relaxed); }
+        bool enabled(Level level) const { return level >= level_.load(std::memory_order_relaxed); }
+
+        // printf 风格；低于运行期级别或级别不在 DEBUG..ERROR 内时忽略，队列满时丢弃该条日志，不阻塞调用线程
+        void log(Level level, const char* format, ...)
+#ifdef __GNUC__
+            __attribute__((format(printf, 3, 4)))
+#endif
+            ;
+
+        long dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    private:
+        // 多生产者单消费者有界队列的槽 (Vyukov)，sequence 表示该槽当前可被谁使用
+        struct Slot
+        {
+            std::atomic<size_t> sequence_;
+            int                 length_;
+            char                text_[MESSAGE_SIZE];
+        };
+
+        Logger();
+        bool pop(char* text, int& length);
+        void run();                                 // 后台写线程
+
+        Slot*               slots_;
+        std::atomic<size_t> enqueue_pos_;
+        size_t              dequeue_pos_;           // 只有写线程访问
+        std::atomic<int>    level_;
+        std::atomic<long>   dropped_;
+        std::atomic<bool>   stop_;
+        double              start_time_;
+        std::thread         writer_;
+    };
+}
+
+#define MYSLAM_LOG(level, ...) \
+    do { \
+        if (myslam::Logger::instance().enabled(level)) \
+            myslam::Logger::instance().log(level, __VA_ARGS__); \
+    } while (0)
+
+#if MYSLAM_LOG_LEVEL <= 0
+#define MYSLAM_DEBUG(...) MYSLAM_LOG(myslam::Logger::DEBUG, __VA_ARGS__)
+#else
+#define MYSLAM_DEBUG(...) do {} while (0)
+#endif
+
+#if MYSLAM_LOG_LEVEL <= 1
+#define MYSLAM_INFO(...) MYSLAM_LOG(myslam::Logger::INFO, __VA_ARGS__)
+#else
+#define MYSLAM_INFO(...) do {} while (0)
+#endif
+
+#if MYSLAM_LOG_LEVEL <= 2
+#define MYSLAM_WARN(...) MYSLAM_LOG(myslam::Logger::WARN, __VA_ARGS__)
+#else
+#define MYSLAM_WARN(...) do {} while (0)
+#endif
+
+#if MYSLAM_LOG_LEVEL <= 3
+#define MYSLAM_ERROR(...) MYSLAM_LOG(myslam::Logger::ERROR, __VA_ARGS__)
+#else
+#define MYSLAM_ERROR(...) do {} while (0)
+#endif
+
+#endif // LOGGER_H
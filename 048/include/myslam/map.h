@@ -7,6 +7,18 @@
 
 namespace myslam
 {
+    // 地图的只读快照，发布后不再修改，读者无需加锁即可长期持有
+    struct MapSnapshot
+    {
+        typedef shared_ptr<const MapSnapshot> Ptr;
+        typedef vector<pair<unsigned long, SE3>, Eigen::aligned_allocator<pair<unsigned long, SE3>>> KeyFramePoses;
+
+        unsigned long                   version_;               // 版本号，每次发布加一
+        shared_ptr<const KeyFramePoses> keyframes_;             // 按 id 排序的关键帧位姿 T_c_w，关键帧不变时各版本共享
+        vector<unsigned long>           map_point_ids_;         // 路标点 id
+        vector<Vector3d>                map_point_positions_;   // 路标点世界坐标
+    };
+
     class Map
     {
     public:
@@ -14,10 +26,28 @@ namespace myslam
         unordered_map<unsigned long, MapPoint::Ptr >  map_points_;        // 所有路标点
         unordered_map<unsigned long, Frame::Ptr >     keyframes_;         // 所有关键帧
 
-        Map() {}
+        Map() : frame_factory_id_(0), map_point_factory_id_(0), version_(0), keyframes_changed_(true) {}
 
         void insertMapPoint(MapPoint::Ptr map_point);                     // 插入路标点
         void insertKeyFrame(Frame::Ptr frame);                            // 插入关键帧
+        bool eraseKeyFrame(unsigned long id);                             // 删除关键帧并从路标点的观测中去掉，不存在时返回 false
+
+        // 每张地图独立分配 ID，多个 VO 实例互不影响
+        unsigned long newFrameId() { return frame_factory_id_++; }
+        unsigned long newMapPointId() { return map_point_factory_id_++; }
+
+        // 写者(跟踪线程)：由当前地图生成新版本快照并原子替换旧版本
+        void publishSnapshot();
+        // 读者(显示、导出等线程)：取得最新快照，不会阻塞写者
+        MapSnapshot::Ptr snapshot() const;
+
+    private:
+        unsigned long frame_factory_id_;
+        unsigned long map_point_factory_id_;
+
+        unsigned long    version_;
+        bool             keyframes_changed_;    // 关键帧变化后才重建关键帧位姿列表
+        MapSnapshot::Ptr snapshot_;             // 只通过 atomic_load/atomic_store 访问
     };
 }
 
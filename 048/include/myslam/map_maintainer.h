@@ -0,0 +1,80 @@
+#ifndef MAP_MAINTAINER_H
+#define MAP_MAINTAINER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "myslam/common_include.h"
+#include "myslam/config.h"
+#include "myslam/map.h"
+
+namespace myslam
+{
+    // 后台地图维护：合并重复路标点、剔除冗余关键帧
+    // 跟踪线程在插入关键帧时提交任务(复制所需数据)，维护线程只处理副本，
+    // 得到的合并/剔除结果再由跟踪线程在下一帧开始时应用到地图，地图本身不需要加锁
+    class MapMaintainer
+    {
+    public:
+        typedef shared_ptr<MapMaintainer> Ptr;
+
+        MapMaintainer(Config::Ptr config);
+        ~MapMaintainer();
+
+        // 跟踪线程调用：插入关键帧之后提交一次维护任务，维护线程未处理完的旧任务被替换
+        void submit(Map::Ptr map, Frame::Ptr keyframe);
+        // 跟踪线程调用：把已完成的结果应用到地图，ref 是当前参考关键帧，不会被剔除
+        void apply(Map::Ptr map, Frame::Ptr ref);
+
+        long fused_points_;         // 已合并的路标点数
+        long culled_keyframes_;     // 已剔除的关键帧数
+
+    private:
+        // 路标点的只读副本
+        struct PointData
+        {
+            unsigned long   id_;
+            Vector3d        pos_;
+            Mat             descriptor_;    // 创建后不再修改，共享数据即可
+            int             matched_times_;
+        };
+
+        // 一次维护任务：最近若干关键帧(最新的在最后)和当时的全部路标点
+        // 关键帧的位姿、特征点和描述子插入地图后不再修改，维护线程可以直接读取
+        struct Job
+        {
+            vector<Frame::Ptr>  keyframes_;
+            vector<PointData>   points_;
+        };
+
+        struct Result
+        {
+            vector<pair<unsigned long, unsigned long>>  fused_;     // (保留的点, 并入的点)
+            vector<unsigned long>                       culled_;    // 冗余关键帧
+        };
+
+        void run();                 // 维护线程
+        void process(const Job& job, Result& result);
+        // 路标点在关键帧中对应的特征点下标，没有对应为 -1
+        void associate(const Frame::Ptr& keyframe, const vector<PointData>& points, vector<int>& keypoint_of_point);
+
+        // 参数
+        int     window_;                // 参与剔除判断的最近关键帧数
+        double  fuse_radius_;           // 投影到特征点的像素距离阈值
+        double  depth_ratio_;           // 合并时深度之差相对保留点深度的最大比例
+        int     descriptor_distance_;   // 描述子 Hamming 距离阈值
+        double  redundant_ratio_;       // 冗余关键帧中被其他关键帧观测到的点的比例
+        int     min_observers_;         // 其他关键帧观测次数达到该值才算被观测到
+
+        std::mutex              mutex_;
+        std::condition_variable cond_;
+        Job                     job_;
+        bool                    has_job_;
+        vector<Result>          results_;
+        bool                    stop_;
+        std::thread             thread_;
+    };
+}
+
+#endif // MAP_MAINTAINER_H
@@ -10,8 +10,7 @@ namespace myslam
     {
     public:
         typedef shared_ptr<MapPoint> Ptr;
-        unsigned long      id_;           // ID
-        static unsigned long factory_id_;    
+        unsigned long      id_;           // ID，由所属地图分配
         bool        good_;                // 是否是好点
         Vector3d    pos_;                 // 世界坐标系上的坐标
         Vector3d    norm_;                // 观察方向法线
@@ -36,8 +35,9 @@ namespace myslam
         }
 
         // 建立MapPoint
-        static MapPoint::Ptr createMapPoint();
+        static MapPoint::Ptr createMapPoint(unsigned long id);
         static MapPoint::Ptr createMapPoint(
+            unsigned long id,
             const Vector3d& pos_world,
             const Vector3d& norm_,
             const Mat& descriptor,
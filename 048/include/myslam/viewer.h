@@ -0,0 +1,71 @@
+#ifndef VIEWER_H
+#define VIEWER_H
+
+#include <atomic>
+#include <thread>
+#include <opencv2/viz.hpp>
+
+#include "myslam/common_include.h"
+#include "myslam/frame.h"
+#include "myslam/map.h"
+
+namespace myslam
+{
+    // 独立线程中的显示：跟踪线程只提交状态，渲染和窗口事件都在显示线程完成
+    class Viewer
+    {
+    public:
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+        typedef shared_ptr<Viewer> Ptr;
+
+        Viewer();
+        ~Viewer();
+
+        void start();
+        void stop();
+
+        // 跟踪线程调用，只写入三缓冲的后台槽，不会等待显示线程
+        // 关键帧需在 FramePool::promote 之后提交，保证引用的是最终的图像缓冲区
+        void update(Frame::Ptr frame, MapSnapshot::Ptr snapshot);
+
+        long submitted() const { return submitted_.load(); }   // 提交的状态数
+        long rendered() const { return rendered_.load(); }     // 实际渲染的状态数，其余被更新的状态覆盖
+
+    private:
+        // 一次提交的显示状态
+        struct State
+        {
+            Frame::Ptr          frame_;         // 持有帧，保证图像缓冲区不被回收
+            Mat                 color_;
+            SE3                 T_c_w_;
+            Camera::Ptr         camera_;
+            MapSnapshot::Ptr    snapshot_;
+            vector<cv::Point3d> trajectory_;        // 显示线程可能还没收到的相机位置，从第 trajectory_begin_ 个起
+            size_t              trajectory_begin_;
+        };
+
+        // 三缓冲：写者独占 back_，读者独占 front_，middle_ 低两位是槽号，FRESH 表示其中有未读的状态
+        static const int FRESH = 4;
+        bool takeFront();
+        void run();                             // 显示线程
+        void render(cv::viz::Viz3d& vis, const State& state);
+
+        State               states_[3];
+        int                 back_;
+        std::atomic<int>    middle_;
+        int                 front_;
+
+        // 跟踪线程：提交过的位置中尚未确认被显示线程收到的部分，及上一次提交的状态包含的位置数
+        vector<cv::Point3d> pending_;
+        size_t              pending_begin_;
+        size_t              published_end_;
+
+        vector<cv::Point3d> trajectory_;        // 显示线程：每次提交的相机位置历史
+        std::atomic<bool>   stop_;
+        std::atomic<long>   submitted_;
+        std::atomic<long>   rendered_;
+        std::thread         thread_;
+    };
+}
+
+#endif // VIEWER_H
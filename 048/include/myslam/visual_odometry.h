@@ -3,11 +3,26 @@
 
 #include "myslam/common_include.h"
 #include "myslam/map.h"
+#include "myslam/config.h"
+#include "myslam/map_maintainer.h"
 
 #include <opencv2/features2d/features2d.hpp>
+#include <random>
 
 namespace myslam
 {
+    // 各处理阶段的耗时(秒)
+    struct StageTimings
+    {
+        double extract_ = 0;       // 提取关键点
+        double descriptor_ = 0;    // 计算描述子
+        double match_ = 0;         // 特征匹配
+        double pose_ = 0;          // PnP 与位姿优化
+        double map_ = 0;           // 地图维护与关键帧
+
+        double total() const { return extract_ + descriptor_ + match_ + pose_ + map_; }
+    };
+
     class VisualOdometry
     {
     public:
@@ -17,11 +32,18 @@ namespace myslam
             OK = 0,
             LOST
         };
+        // 位姿估计方式：3D-2D PnP，或利用当前帧深度的 3D-3D 对齐
+        enum TrackingMode {
+            PNP = 0,
+            RGBD
+        };
 
         VOState     state_;     // 当前 VO 状态 
+        Config::Ptr config_;    // 本实例的配置
         Map::Ptr    map_;       // 映射所有帧和映射点
         Frame::Ptr  ref_;       // 参考坐标系
         Frame::Ptr  curr_;      // 当前帧
+        MapMaintainer::Ptr maintainer_; // 后台地图维护，未启用时为空
 
         cv::Ptr<cv::ORB> orb_;  // ORB 检测和计算器
         vector<cv::KeyPoint>    keypoints_curr_;    // 当前帧中的关键点
@@ -43,23 +65,34 @@ namespace myslam
         float match_ratio_;     // 良好匹配率
         int max_num_lost_;      // 连续丢失的最大次数
         int min_inliers_;       // 最小内点数
+        int pnp_iterations_;    // PnP RANSAC 迭代次数
+        int optimize_iterations_;   // g2o 位姿优化迭代次数
+        int tracking_mode_;         // 位姿估计方式
+        double rgbd_inlier_threshold_;  // 3D-3D 内点阈值(米)
+        std::mt19937 rng_;          // RANSAC 采样
 
         double key_frame_min_rot;   // 两个关键帧的最小旋转
         double key_frame_min_trans; // 两个关键帧的最小平移
 
         double  map_point_erase_ratio_; // 地图点删除比例
 
+        StageTimings timings_;  // 最近一帧各阶段耗时
+
     public: // 函数
-        VisualOdometry();
+        VisualOdometry(Config::Ptr config);
         ~VisualOdometry();
 
         bool addFrame(Frame::Ptr frame);      // 添加帧
 
+        // 在线调整特征数与金字塔层数
+        void setFeatureParams(int num_of_features, int level_pyramid);
+
     protected: // 内部操作
         void extractKeyPoints();      // 提取关键点 
         void computeDescriptors();    // 计算描述子
         void featureMatching();       // 在上一帧的特征点3D坐标和当前的特征点2D坐标匹配
         void poseEstimationPnP();     // 姿势估计
+        void poseEstimationRGBD();    // 3D-3D 姿势估计
         
         void addMapPoints();          // 添加地图点
         void optimizeMap();           // 优化地图
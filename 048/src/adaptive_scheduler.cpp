@@ -0,0 +1,106 @@
+#include <algorithm>
+
+#include "myslam/adaptive_scheduler.h"
+#include "myslam/logger.h"
+
+namespace myslam
+{
+    static const int    COOLDOWN_FRAMES = 3;    // 调整后观察的帧数
+    static const int    RECOVER_FRAMES = 10;    // 连续多少帧宽裕才恢复一档
+    static const double RECOVER_RATIO = 0.7;    // 平均耗时低于预算的该比例视为宽裕
+
+    AdaptiveScheduler::AdaptiveScheduler(VisualOdometry::Ptr vo, double frame_budget) :
+        over_budget_frames_(0), degraded_frames_(0), vo_(vo), budget_(frame_budget),
+        average_cost_(0), feature_level_(0), pose_level_(0), cooldown_(0), calm_frames_(0)
+    {
+        nominal_features_ = vo_->num_of_features_;
+        nominal_pyramid_ = vo_->level_pyramid_;
+        nominal_pnp_ = vo_->pnp_iterations_;
+        nominal_optimize_ = vo_->optimize_iterations_;
+    }
+
+    bool AdaptiveScheduler::update()
+    {
+        const StageTimings& t = vo_->timings_;
+        double cost = t.total();
+        if (cost <= 0)
+            return false;   // 跟丢时没有处理
+
+        average_cost_ = average_cost_ == 0 ? cost : 0.8 * average_cost_ + 0.2 * cost;
+        bool over_budget = cost > budget_;
+        if (over_budget)
+            over_budget_frames_++;
+        if (degraded())
+            degraded_frames_++;
+
+        if (cooldown_ > 0)
+        {
+            cooldown_--;
+            return over_budget;
+        }
+
+        bool changed = false;
+        if (average_cost_ > budget_)
+        {
+            calm_frames_ = 0;
+            // 优先降低耗时占比较大的一组阶段
+            double feature_cost = t.extract_ + t.descriptor_ + t.match_;
+            bool prefer_features = feature_cost >= t.pose_;
+            if (feature_level_ < MAX_LEVEL && (prefer_features || pose_level_ == MAX_LEVEL))
+            {
+                feature_level_++;
+                changed = true;
+            }
+            else if (pose_level_ < MAX_LEVEL)
+            {
+                pose_level_++;
+                changed = true;
+            }
+        }
+        else if (average_cost_ < RECOVER_RATIO * budget_ && degraded())
+        {
+            if (++calm_frames_ >= RECOVER_FRAMES)
+            {
+                // 先恢复特征数，它对跟踪质量影响最大
+                if (feature_level_ > 0)
+                    feature_level_--;
+                else
+                    pose_level_--;
+                calm_frames_ = 0;
+                changed = true;
+            }
+        }
+        else
+        {
+            calm_frames_ = 0;
+        }
+
+        if (changed)
+        {
+            apply();
+            cooldown_ = COOLDOWN_FRAMES;
+            MYSLAM_INFO("scheduler: average cost %f s, budget %f s -> features %d, pyramid %d, "
+                "pnp iterations %d, optimize iterations %d",
+                average_cost_, budget_, vo_->num_of_features_, vo_->level_pyramid_,
+                vo_->pnp_iterations_, vo_->optimize_iterations_);
+        }
+        else if (average_cost_ > budget_ && feature_level_ == MAX_LEVEL && pose_level_ == MAX_LEVEL)
+        {
+            MYSLAM_WARN("scheduler: cannot meet budget %f s even fully degraded", budget_);
+        }
+        return over_budget;
+    }
+
+    void AdaptiveScheduler::apply()
+    {
+        double feature_scale = 1.0 - 0.1 * feature_level_;
+        double pose_scale = 1.0 - 0.15 * pose_level_;
+
+        int num_of_features = std::max(100, int(nominal_features_ * feature_scale));
+        int level_pyramid = std::max(1, nominal_pyramid_ - feature_level_ / 2);
+        vo_->setFeatureParams(num_of_features, level_pyramid);
+
+        vo_->pnp_iterations_ = std::max(20, int(nominal_pnp_ * pose_scale));
+        vo_->optimize_iterations_ = std::max(2, int(nominal_optimize_ * pose_scale));
+    }
+}
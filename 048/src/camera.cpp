@@ -1,16 +1,14 @@
 #include "myslam/camera.h"
 
-#include <myslam/config.h>
-
 namespace myslam
 {
-    Camera::Camera()
+    Camera::Camera(Config::Ptr config)
     {
-        fx_ = Config::get<float>("camera.fx");
-        fy_ = Config::get<float>("camera.fy");
-        cx_ = Config::get<float>("camera.cx");
-        cy_ = Config::get<float>("camera.cy");
-        depth_scale_ = Config::get<float>("camera.depth_scale");
+        fx_ = config->get<float>("camera.fx");
+        fy_ = config->get<float>("camera.fy");
+        cx_ = config->get<float>("camera.cx");
+        cy_ = config->get<float>("camera.cy");
+        depth_scale_ = config->get<float>("camera.depth_scale");
     }
 
     Vector3d Camera::world2camera(const Vector3d& p_w, const SE3& T_c_w)
@@ -2,17 +2,17 @@
 
 namespace myslam
 {
-    void Config::setParameterFile(const std::string& filename)
+    Config::Ptr Config::create(const std::string& filename)
     {
-        if (config_ == nullptr)
-            config_ = shared_ptr<Config>(new Config);
-        config_->file_ = cv::FileStorage(filename.c_str(), cv::FileStorage::READ);
-        if (config_->file_.isOpened() == false)
+        Config::Ptr config(new Config);
+        config->file_ = cv::FileStorage(filename.c_str(), cv::FileStorage::READ);
+        if (config->file_.isOpened() == false)
         {
             std::cerr << "parameter file " << filename << " does not exist." << std::endl;
-            config_->file_.release();
-            return;
+            config->file_.release();
+            return nullptr;
         }
+        return config;
     }
 
     Config::~Config()
@@ -20,6 +20,4 @@ namespace myslam
         if (file_.isOpened())
             file_.release();
     }
-
-    shared_ptr<Config> Config::config_ = nullptr;
 }
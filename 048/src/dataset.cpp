@@ -0,0 +1,27 @@
+#include <fstream>
+
+#include "myslam/dataset.h"
+
+namespace myslam
+{
+    bool Dataset::load()
+    {
+        ifstream fin(dataset_dir_ + "/associate.txt");
+        if (!fin)
+            return false;
+
+        while (!fin.eof())
+        {
+            string rgb_time, rgb_file, depth_time, depth_file;
+            fin >> rgb_time >> rgb_file >> depth_time >> depth_file;
+            rgb_times_.push_back(atof(rgb_time.c_str()));
+            depth_times_.push_back(atof(depth_time.c_str()));
+            rgb_files_.push_back(dataset_dir_ + "/" + rgb_file);
+            depth_files_.push_back(dataset_dir_ + "/" + depth_file);
+
+            if (fin.good() == false)
+                break;
+        }
+        return true;
+    }
+}
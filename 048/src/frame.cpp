@@ -3,13 +3,13 @@
 namespace myslam
 {
     Frame::Frame()
-        : id_(-1), time_stamp_(-1), camera_(nullptr)
+        : id_(-1), time_stamp_(-1), camera_(nullptr), is_key_frame_(false)
     {
 
     }
 
     Frame::Frame(long id, double time_stamp, SE3 T_c_w, Camera::Ptr camera, Mat color, Mat depth)
-        : id_(id), time_stamp_(time_stamp), T_c_w_(T_c_w), camera_(camera), color_(color), depth_(depth)
+        : id_(id), time_stamp_(time_stamp), T_c_w_(T_c_w), camera_(camera), color_(color), depth_(depth), is_key_frame_(false)
     {
 
     }
@@ -22,8 +22,7 @@ namespace myslam
     // 创建 Frame
     Frame::Ptr Frame::createFrame()
     {
-        static long factory_id = 0;
-        return Frame::Ptr(new Frame(factory_id++));
+        return Frame::Ptr(new Frame);
     }
 
     // 寻找给定点对应的深度
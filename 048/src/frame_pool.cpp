@@ -0,0 +1,130 @@
+#include <fstream>
+#include <iterator>
+#include <opencv2/imgcodecs.hpp>
+
+#include "myslam/frame_pool.h"
+
+namespace myslam
+{
+    FramePool::FramePool(int rows, int cols, int capacity)
+        : rows_(rows), cols_(cols)
+    {
+        for (int i = 0; i < capacity; i++)
+            free_buffers_.push_back(addBuffer());
+    }
+
+    FramePool::~FramePool()
+    {
+        // 借出的帧持有池的引用，此时所有帧都已归还
+        for (Frame* frame : free_frames_)
+            delete frame;
+    }
+
+    int FramePool::addBuffer()
+    {
+        Buffer buffer;
+        buffer.color_.create(rows_, cols_, CV_8UC3);
+        buffer.depth_.create(rows_, cols_, CV_16UC1);
+        buffers_.push_back(buffer);
+        return buffers_.size() - 1;
+    }
+
+    Frame::Ptr FramePool::acquire()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Frame* frame = nullptr;
+        if (free_frames_.empty())
+        {
+            frame = new Frame;
+        }
+        else
+        {
+            frame = free_frames_.back();
+            free_frames_.pop_back();
+        }
+        frame->id_ = -1;
+        frame->time_stamp_ = -1;
+        frame->T_c_w_ = SE3();
+        frame->is_key_frame_ = false;
+
+        int index;
+        if (free_buffers_.empty())
+        {
+            index = addBuffer();
+        }
+        else
+        {
+            index = free_buffers_.back();
+            free_buffers_.pop_back();
+        }
+        frame->color_ = buffers_[index].color_;
+        frame->depth_ = buffers_[index].depth_;
+        frame_buffer_[frame] = index;
+
+        // 删除器持有池的引用，保证池比借出的帧活得久
+        FramePool::Ptr self = shared_from_this();
+        return Frame::Ptr(frame, [self](Frame* f) { self->recycle(f); });
+    }
+
+    bool FramePool::readImages(Frame::Ptr frame, const string& color_file, const string& depth_file)
+    {
+        // 每个线程复用自己的文件缓冲区
+        static thread_local vector<uchar> file_buffer;
+        const string* files[2] = { &color_file, &depth_file };
+        Mat* images[2] = { &frame->color_, &frame->depth_ };
+        const int flags[2] = { cv::IMREAD_COLOR, cv::IMREAD_UNCHANGED };
+        for (int i = 0; i < 2; i++)
+        {
+            ifstream fin(*files[i], ios::binary);
+            if (!fin)
+                return false;
+            file_buffer.assign(istreambuf_iterator<char>(fin), istreambuf_iterator<char>());
+            // 尺寸和类型一致时 imdecode 直接写入已有缓冲区
+            cv::imdecode(file_buffer, flags[i], images[i]);
+            if (images[i]->data == nullptr)
+                return false;
+        }
+        return true;
+    }
+
+    void FramePool::promote(Frame::Ptr frame)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto iter = frame_buffer_.find(frame.get());
+        if (iter == frame_buffer_.end())
+            return;
+        frame->color_ = frame->color_.clone();
+        frame->depth_ = frame->depth_.clone();
+        free_buffers_.push_back(iter->second);
+        frame_buffer_.erase(iter);
+    }
+
+    void FramePool::recycle(Frame* frame)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto iter = frame_buffer_.find(frame);
+        if (iter != frame_buffer_.end())
+        {
+            free_buffers_.push_back(iter->second);
+            frame_buffer_.erase(iter);
+        }
+        frame->color_ = Mat();
+        frame->depth_ = Mat();
+        frame->camera_ = nullptr;
+        frame->keypoints_.clear();
+        frame->descriptors_ = Mat();
+        free_frames_.push_back(frame);
+    }
+
+    int FramePool::numBuffers()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return buffers_.size();
+    }
+
+    int FramePool::numFreeBuffers()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return free_buffers_.size();
+    }
+}
@@ -0,0 +1,136 @@
+#include <chrono>
+#include <thread>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "myslam/frame_queue.h"
+
+namespace myslam
+{
+    void ReplayClock::start(double first_stamp)
+    {
+        first_stamp_ = first_stamp;
+        start_time_ = now();
+    }
+
+    double ReplayClock::due(double time_stamp) const
+    {
+        return start_time_ + (time_stamp - first_stamp_) / rate_;
+    }
+
+    void ReplayClock::waitUntil(double time_stamp) const
+    {
+        double wait = due(time_stamp) - now();
+        if (wait > 0)
+            std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+    }
+
+    double ReplayClock::now()
+    {
+        return std::chrono::duration<double>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // 40x30 的灰度缩略图，计算帧间差异足够且代价很小
+    static Mat makeThumb(const Mat& color)
+    {
+        Mat small, gray;
+        cv::resize(color, small, cv::Size(40, 30), 0, 0, cv::INTER_AREA);
+        cv::cvtColor(small, gray, cv::COLOR_BGR2GRAY);
+        return gray;
+    }
+
+    // 两幅缩略图的平均灰度差
+    static double thumbDifference(const Mat& a, const Mat& b)
+    {
+        if (a.empty() || b.empty())
+            return 0;
+        double sum = 0;
+        for (int y = 0; y < a.rows; y++)
+        {
+            const uchar* pa = a.ptr<uchar>(y);
+            const uchar* pb = b.ptr<uchar>(y);
+            for (int x = 0; x < a.cols; x++)
+                sum += std::abs(int(pa[x]) - int(pb[x]));
+        }
+        return sum / (a.rows * a.cols);
+    }
+
+    void FrameQueue::push(Frame::Ptr frame, double arrival)
+    {
+        Item item;
+        item.frame_ = frame;
+        item.arrival_ = arrival;
+        if (policy_ == PRIORITIZE_KEYFRAME)
+            item.thumb_ = makeThumb(frame->color_);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pushed_++;
+            if (policy_ == KEEP_LATEST)
+            {
+                dropped_ += items_.size();
+                items_.clear();
+            }
+            items_.push_back(item);
+            while (items_.size() > capacity_)
+                dropOne();
+        }
+        cond_.notify_one();
+    }
+
+    void FrameQueue::dropOne()
+    {
+        dropped_++;
+        if (policy_ != PRIORITIZE_KEYFRAME)
+        {
+            items_.pop_front();
+            return;
+        }
+        // 与上一处理帧差异最小的帧最不可能成为关键帧；最新一帧总是保留
+        size_t drop = 0;
+        double min_difference = 1e10;
+        for (size_t i = 0; i + 1 < items_.size(); i++)
+        {
+            double difference = thumbDifference(items_[i].thumb_, last_thumb_);
+            if (difference < min_difference)
+            {
+                min_difference = difference;
+                drop = i;
+            }
+        }
+        items_.erase(items_.begin() + drop);
+    }
+
+    bool FrameQueue::pop(Item& item)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this] { return !items_.empty() || closed_; });
+        if (items_.empty())
+            return false;
+        item = items_.front();
+        items_.pop_front();
+        last_thumb_ = item.thumb_;
+        return true;
+    }
+
+    void FrameQueue::close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        cond_.notify_all();
+    }
+
+    long FrameQueue::pushed()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return pushed_;
+    }
+
+    long FrameQueue::dropped()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return dropped_;
+    }
+}
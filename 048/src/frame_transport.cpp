@@ -0,0 +1,273 @@
+#include <chrono>
+#include <thread>
+#include <new>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "myslam/frame_transport.h"
+
+namespace myslam
+{
+    static const uint32_t FRAME_RING_MAGIC = 0x4d594652; // "MYFR"
+
+    // 按缓存行对齐
+    static inline uint64_t alignUp(uint64_t size)
+    {
+        return (size + 63) & ~uint64_t(63);
+    }
+
+    FrameTransport::~FrameTransport()
+    {
+        if (base_ != nullptr)
+            munmap(base_, size_);
+        if (owner_)
+            shm_unlink(name_.c_str());
+    }
+
+    FrameTransport::Ptr FrameTransport::create(const string& name, int num_slots, int rows, int cols, bool force)
+    {
+        uint64_t color_offset = alignUp(sizeof(FrameSlotHeader));
+        uint64_t depth_offset = color_offset + alignUp(uint64_t(rows) * cols * 3);
+        uint64_t slot_size = depth_offset + alignUp(uint64_t(rows) * cols * 2);
+        size_t size = alignUp(sizeof(FrameRingHeader)) + slot_size * num_slots;
+
+        // 同名的段可能属于仍在运行的生产者，只有明确要求时才清理(上次异常退出的遗留)
+        if (force)
+            shm_unlink(name.c_str());
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0)
+        {
+            if (errno == EEXIST)
+                cerr << "shared memory " << name << " already exists, another producer may be running "
+                    << "(use --force to remove a stale segment)" << endl;
+            else
+                cerr << "cannot create shared memory " << name << endl;
+            return nullptr;
+        }
+        if (ftruncate(fd, size) != 0)
+        {
+            cerr << "cannot resize shared memory " << name << endl;
+            ::close(fd);
+            shm_unlink(name.c_str());
+            return nullptr;
+        }
+        void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED)
+        {
+            shm_unlink(name.c_str());
+            return nullptr;
+        }
+
+        FrameTransport::Ptr transport(new FrameTransport);
+        transport->base_ = static_cast<uint8_t*>(base);
+        transport->size_ = size;
+        transport->name_ = name;
+        transport->owner_ = true;
+
+        FrameRingHeader* header = new (base) FrameRingHeader;
+        header->num_slots_ = num_slots;
+        header->rows_ = rows;
+        header->cols_ = cols;
+        header->slot_size_ = slot_size;
+        header->color_offset_ = color_offset;
+        header->depth_offset_ = depth_offset;
+        header->write_index_.store(0, std::memory_order_relaxed);
+        header->read_index_.store(0, std::memory_order_relaxed);
+        header->closed_.store(0, std::memory_order_relaxed);
+        // 头部完全初始化后才写入校验字
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic_ = FRAME_RING_MAGIC;
+        transport->header_ = header;
+        return transport;
+    }
+
+    FrameTransport::Ptr FrameTransport::open(const string& name)
+    {
+        int fd = shm_open(name.c_str(), O_RDWR, 0600);
+        if (fd < 0)
+            return nullptr;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(FrameRingHeader))
+        {
+            ::close(fd);
+            return nullptr;
+        }
+        void* base = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED)
+            return nullptr;
+
+        FrameTransport::Ptr transport(new FrameTransport);
+        transport->base_ = static_cast<uint8_t*>(base);
+        transport->size_ = st.st_size;
+        transport->name_ = name;
+        transport->header_ = static_cast<FrameRingHeader*>(base);
+        const FrameRingHeader* header = transport->header_;
+        if (header->magic_ != FRAME_RING_MAGIC)
+        {
+            cerr << "shared memory " << name << " is not a frame ring" << endl;
+            return nullptr;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        // 头部描述的布局必须落在映射范围内，否则截断或来历不明的段会被越界读取
+        uint64_t pixels = uint64_t(header->rows_) * uint64_t(header->cols_);
+        uint64_t slots_offset = alignUp(sizeof(FrameRingHeader));
+        bool layout_ok = header->rows_ > 0 && header->cols_ > 0 && header->num_slots_ > 0
+            && header->color_offset_ >= sizeof(FrameSlotHeader)
+            && header->depth_offset_ >= header->color_offset_ + pixels * 3
+            && header->slot_size_ >= header->depth_offset_ + pixels * 2
+            && header->slot_size_ <= (uint64_t(st.st_size) - std::min<uint64_t>(st.st_size, slots_offset)) / header->num_slots_;
+        if (!layout_ok)
+        {
+            cerr << "shared memory " << name << " is smaller than its frame ring header describes" << endl;
+            return nullptr;
+        }
+        return transport;
+    }
+
+    FrameSlotHeader* FrameTransport::slot(uint64_t index) const
+    {
+        uint8_t* slots = base_ + alignUp(sizeof(FrameRingHeader));
+        return reinterpret_cast<FrameSlotHeader*>(
+            slots + (index % header_->num_slots_) * header_->slot_size_);
+    }
+
+    Mat FrameTransport::colorOf(FrameSlotHeader* slot) const
+    {
+        return Mat(header_->rows_, header_->cols_, CV_8UC3,
+            reinterpret_cast<uint8_t*>(slot) + header_->color_offset_);
+    }
+
+    Mat FrameTransport::depthOf(FrameSlotHeader* slot) const
+    {
+        return Mat(header_->rows_, header_->cols_, CV_16UC1,
+            reinterpret_cast<uint8_t*>(slot) + header_->depth_offset_);
+    }
+
+    bool FrameTransport::beginWrite(Mat& color, Mat& depth)
+    {
+        uint64_t w = header_->write_index_.load(std::memory_order_relaxed);
+        uint64_t r = header_->read_index_.load(std::memory_order_acquire);
+        if (w - r >= header_->num_slots_)
+            return false;   // 消费者还没有释放最旧的槽
+        FrameSlotHeader* s = slot(w);
+        color = colorOf(s);
+        depth = depthOf(s);
+        return true;
+    }
+
+    void FrameTransport::endWrite(double time_stamp)
+    {
+        uint64_t w = header_->write_index_.load(std::memory_order_relaxed);
+        FrameSlotHeader* s = slot(w);
+        s->sequence_ = w;
+        s->time_stamp_ = time_stamp;
+        s->publish_time_ = now();
+        header_->write_index_.store(w + 1, std::memory_order_release);
+    }
+
+    void FrameTransport::close()
+    {
+        header_->closed_.store(1, std::memory_order_release);
+    }
+
+    bool FrameTransport::beginRead(Mat& color, Mat& depth, double& time_stamp, double& publish_time)
+    {
+        uint64_t r = header_->read_index_.load(std::memory_order_relaxed);
+        uint64_t w = header_->write_index_.load(std::memory_order_acquire);
+        if (r == w)
+            return false;
+        FrameSlotHeader* s = slot(r);
+        color = colorOf(s);
+        depth = depthOf(s);
+        time_stamp = s->time_stamp_;
+        publish_time = s->publish_time_;
+        return true;
+    }
+
+    void FrameTransport::endRead()
+    {
+        uint64_t r = header_->read_index_.load(std::memory_order_relaxed);
+        header_->read_index_.store(r + 1, std::memory_order_release);
+    }
+
+    bool FrameTransport::closed() const
+    {
+        return header_->closed_.load(std::memory_order_acquire) != 0;
+    }
+
+    bool FrameTransport::drained() const
+    {
+        return header_->read_index_.load(std::memory_order_acquire)
+            == header_->write_index_.load(std::memory_order_acquire);
+    }
+
+    int FrameTransport::pending() const
+    {
+        return int(header_->write_index_.load(std::memory_order_acquire)
+            - header_->read_index_.load(std::memory_order_acquire));
+    }
+
+    double FrameTransport::now()
+    {
+        return std::chrono::duration<double>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    SharedMemoryFrameSource::~SharedMemoryFrameSource()
+    {
+        releaseCurrent();
+    }
+
+    Frame::Ptr SharedMemoryFrameSource::grab()
+    {
+        releaseCurrent();
+
+        Mat color, depth;
+        double time_stamp, publish_time;
+        while (!transport_->beginRead(color, depth, time_stamp, publish_time))
+        {
+            if (transport_->closed())
+            {
+                // 生产者结束后再检查一次，避免丢掉最后一帧
+                if (transport_->beginRead(color, depth, time_stamp, publish_time))
+                    break;
+                return nullptr;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        latency_ = FrameTransport::now() - publish_time;
+
+        current_ = Frame::createFrame();
+        current_->camera_ = camera_;
+        current_->color_ = color;
+        current_->depth_ = depth;
+        current_->time_stamp_ = time_stamp;
+        return current_;
+    }
+
+    void SharedMemoryFrameSource::releaseCurrent()
+    {
+        if (current_ == nullptr)
+            return;
+        if (current_->is_key_frame_)
+        {
+            // 关键帧会被地图长期持有，拷贝到自有内存后再归还槽
+            current_->color_ = current_->color_.clone();
+            current_->depth_ = current_->depth_.clone();
+        }
+        else
+        {
+            // 普通帧不再使用图像，断开与槽的联系
+            current_->color_ = Mat();
+            current_->depth_ = Mat();
+        }
+        transport_->endRead();
+        current_.reset();
+    }
+}
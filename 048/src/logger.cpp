@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+
+#include "myslam/logger.h"
+
+namespace myslam
+{
+    static double now()
+    {
+        return std::chrono::duration<double>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    Logger& Logger::instance()
+    {
+        static Logger logger;
+        return logger;
+    }
+
+    Logger::Logger()
+        : slots_(new Slot[QUEUE_SIZE]), enqueue_pos_(0), dequeue_pos_(0),
+          level_(INFO), dropped_(0), stop_(false), start_time_(now())
+    {
+        for (size_t i = 0; i < QUEUE_SIZE; i++)
+            slots_[i].sequence_.store(i, std::memory_order_relaxed);
+        writer_ = std::thread(&Logger::run, this);
+    }
+
+    Logger::~Logger()
+    {
+        // 写线程退出前会清空队列
+        stop_.store(true);
+        writer_.join();
+        delete[] slots_;
+    }
+
+    void Logger::log(Level level, const char* format, ...)
+    {
+        static const char* names[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+        // OFF 只用作阈值，不是日志级别；直接调用 log() 时也按运行期级别过滤
+        if (level < DEBUG || level >= OFF || !enabled(level))
+            return;
+        double stamp = now() - start_time_;
+
+        // 抢占一个空闲槽；队列满则丢弃
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;)
+        {
+            slot = &slots_[pos & (QUEUE_SIZE - 1)];
+            size_t sequence = slot->sequence_.load(std::memory_order_acquire);
+            intptr_t diff = intptr_t(sequence) - intptr_t(pos);
+            if (diff == 0)
+            {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            else
+            {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        // 直接格式化到槽内，末尾保证换行
+        int length = snprintf(slot->text_, MESSAGE_SIZE, "[%12.6f %-5s] ", stamp, names[level]);
+        va_list args;
+        va_start(args, format);
+        int body = vsnprintf(slot->text_ + length, MESSAGE_SIZE - length, format, args);
+        va_end(args);
+        length = body < 0 ? length : std::min(length + body, MESSAGE_SIZE - 2);
+        slot->text_[length++] = '\n';
+        slot->length_ = length;
+
+        slot->sequence_.store(pos + 1, std::memory_order_release);
+    }
+
+    bool Logger::pop(char* text, int& length)
+    {
+        Slot* slot = &slots_[dequeue_pos_ & (QUEUE_SIZE - 1)];
+        if (slot->sequence_.load(std::memory_order_acquire) != dequeue_pos_ + 1)
+            return false;
+        length = slot->length_;
+        std::copy(slot->text_, slot->text_ + length, text);
+        slot->sequence_.store(dequeue_pos_ + QUEUE_SIZE, std::memory_order_release);
+        dequeue_pos_++;
+        return true;
+    }
+
+    void Logger::run()
+    {
+        char text[MESSAGE_SIZE];
+        int length;
+        long reported_dropped = 0;
+        for (;;)
+        {
+            // 先读 stop_ 再清空队列，保证退出时不丢已入队的日志
+            bool stop = stop_.load();
+            bool written = false;
+            while (pop(text, length))
+            {
+                fwrite(text, 1, length, stdout);
+                written = true;
+            }
+            long dropped = dropped_.load(std::memory_order_relaxed);
+            if (dropped != reported_dropped)
+            {
+                fprintf(stdout, "[logger] %ld messages dropped\n", dropped - reported_dropped);
+                reported_dropped = dropped;
+                written = true;
+            }
+            // 一批日志只刷新一次
+            if (written)
+                fflush(stdout);
+            if (stop)
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
@@ -1,10 +1,14 @@
+#include <algorithm>
+#include <atomic>
+
 #include "myslam/map.h"
+#include "myslam/logger.h"
 
 namespace myslam
 {
     void Map::insertKeyFrame(Frame::Ptr frame)
     {
-        cout << "Key frame size = " << keyframes_.size() << endl;
+        MYSLAM_DEBUG("Key frame size = %zu", keyframes_.size());
         if (keyframes_.find(frame->id_) == keyframes_.end())
         {
             keyframes_.insert(make_pair(frame->id_, frame));
@@ -13,6 +17,21 @@ namespace myslam
         {
             keyframes_[frame->id_] = frame;
         }
+        keyframes_changed_ = true;
+    }
+
+    bool Map::eraseKeyFrame(unsigned long id)
+    {
+        auto kf = keyframes_.find(id);
+        if (kf == keyframes_.end())
+            return false;
+        // 路标点只保存观测帧的裸指针，关键帧移出地图后可能被释放，先从各点的观测列表中去掉
+        Frame* frame = kf->second.get();
+        for (auto& mp : map_points_)
+            mp.second->observed_frames_.remove(frame);
+        keyframes_.erase(kf);
+        keyframes_changed_ = true;
+        return true;
     }
 
     void Map::insertMapPoint(MapPoint::Ptr map_point)
@@ -26,4 +45,46 @@ namespace myslam
             map_points_[map_point->id_] = map_point;
         }
     }
+
+    void Map::publishSnapshot()
+    {
+        shared_ptr<MapSnapshot> snapshot(new MapSnapshot);
+        snapshot->version_ = ++version_;
+
+        MapSnapshot::Ptr previous = std::atomic_load(&snapshot_);
+        if (keyframes_changed_ || previous == nullptr)
+        {
+            shared_ptr<MapSnapshot::KeyFramePoses> keyframes(new MapSnapshot::KeyFramePoses);
+            keyframes->reserve(keyframes_.size());
+            for (auto& kf : keyframes_)
+                keyframes->push_back(make_pair(kf.first, kf.second->T_c_w_));
+            std::sort(keyframes->begin(), keyframes->end(),
+                [](const pair<unsigned long, SE3>& a, const pair<unsigned long, SE3>& b)
+            {
+                return a.first < b.first;
+            });
+            snapshot->keyframes_ = keyframes;
+            keyframes_changed_ = false;
+        }
+        else
+        {
+            snapshot->keyframes_ = previous->keyframes_;
+        }
+
+        snapshot->map_point_ids_.reserve(map_points_.size());
+        snapshot->map_point_positions_.reserve(map_points_.size());
+        for (auto& mp : map_points_)
+        {
+            snapshot->map_point_ids_.push_back(mp.first);
+            snapshot->map_point_positions_.push_back(mp.second->pos_);
+        }
+
+        // 旧快照在最后一个读者释放后自动回收
+        std::atomic_store(&snapshot_, MapSnapshot::Ptr(snapshot));
+    }
+
+    MapSnapshot::Ptr Map::snapshot() const
+    {
+        return std::atomic_load(&snapshot_);
+    }
 }
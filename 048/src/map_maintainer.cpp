@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <cmath>
+
+#include "myslam/map_maintainer.h"
+#include "myslam/logger.h"
+
+namespace myslam
+{
+    MapMaintainer::MapMaintainer(Config::Ptr config)
+        : fused_points_(0), culled_keyframes_(0), has_job_(false), stop_(false)
+    {
+        window_ = config->get<int>("maintenance.window");
+        fuse_radius_ = config->get<double>("maintenance.fuse_radius");
+        depth_ratio_ = config->get<double>("maintenance.depth_ratio");
+        descriptor_distance_ = config->get<int>("maintenance.descriptor_distance");
+        redundant_ratio_ = config->get<double>("maintenance.redundant_ratio");
+        min_observers_ = config->get<int>("maintenance.min_observers");
+        thread_ = std::thread(&MapMaintainer::run, this);
+    }
+
+    MapMaintainer::~MapMaintainer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cond_.notify_one();
+        thread_.join();
+    }
+
+    void MapMaintainer::submit(Map::Ptr map, Frame::Ptr keyframe)
+    {
+        Job job;
+        // 最近 window_ 个关键帧，按 id 从旧到新
+        for (auto& kf : map->keyframes_)
+            job.keyframes_.push_back(kf.second);
+        std::sort(job.keyframes_.begin(), job.keyframes_.end(),
+            [](const Frame::Ptr& a, const Frame::Ptr& b)
+        {
+            return a->id_ < b->id_;
+        });
+        if (int(job.keyframes_.size()) > window_)
+            job.keyframes_.erase(job.keyframes_.begin(), job.keyframes_.end() - window_);
+
+        job.points_.reserve(map->map_points_.size());
+        for (auto& mp : map->map_points_)
+        {
+            PointData point;
+            point.id_ = mp.first;
+            point.pos_ = mp.second->pos_;
+            point.descriptor_ = mp.second->descriptor_;
+            point.matched_times_ = mp.second->matched_times_;
+            job.points_.push_back(point);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = std::move(job);
+            has_job_ = true;
+        }
+        cond_.notify_one();
+    }
+
+    void MapMaintainer::apply(Map::Ptr map, Frame::Ptr ref)
+    {
+        vector<Result> results;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            results.swap(results_);
+        }
+
+        for (const Result& result : results)
+        {
+            int fused = 0, culled = 0;
+            // 结果产生之后地图可能已经变化，两个点都还在才合并
+            for (const pair<unsigned long, unsigned long>& f : result.fused_)
+            {
+                auto keep = map->map_points_.find(f.first);
+                auto remove = map->map_points_.find(f.second);
+                if (keep == map->map_points_.end() || remove == map->map_points_.end())
+                    continue;
+                keep->second->visible_times_ += remove->second->visible_times_;
+                keep->second->matched_times_ += remove->second->matched_times_;
+                keep->second->observed_frames_.splice(
+                    keep->second->observed_frames_.end(), remove->second->observed_frames_);
+                map->map_points_.erase(remove);
+                fused++;
+            }
+            for (unsigned long id : result.culled_)
+            {
+                if (ref != nullptr && id == ref->id_)
+                    continue;
+                if (map->eraseKeyFrame(id))
+                    culled++;
+            }
+            fused_points_ += fused;
+            culled_keyframes_ += culled;
+            if (fused > 0 || culled > 0)
+                MYSLAM_DEBUG("map maintenance: fused %d points, culled %d key frames", fused, culled);
+        }
+    }
+
+    void MapMaintainer::run()
+    {
+        for (;;)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cond_.wait(lock, [this] { return has_job_ || stop_; });
+                if (stop_)
+                    break;
+                job = std::move(job_);
+                has_job_ = false;
+            }
+
+            Result result;
+            process(job, result);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            results_.push_back(std::move(result));
+        }
+    }
+
+    void MapMaintainer::associate(const Frame::Ptr& keyframe, const vector<PointData>& points, vector<int>& keypoint_of_point)
+    {
+        keypoint_of_point.assign(points.size(), -1);
+        const vector<cv::KeyPoint>& keypoints = keyframe->keypoints_;
+        if (keypoints.empty())
+            return;
+
+        // 特征点按网格分桶，格子边长不小于搜索半径，只需查找相邻格子
+        double cell = std::max(fuse_radius_, 1.0);
+        int grid_cols = 1, grid_rows = 1;
+        for (const cv::KeyPoint& kp : keypoints)
+        {
+            grid_cols = std::max(grid_cols, int(kp.pt.x / cell) + 1);
+            grid_rows = std::max(grid_rows, int(kp.pt.y / cell) + 1);
+        }
+        vector<vector<int>> grid(grid_cols * grid_rows);
+        for (size_t i = 0; i < keypoints.size(); i++)
+            grid[int(keypoints[i].pt.y / cell) * grid_cols + int(keypoints[i].pt.x / cell)].push_back(i);
+
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            Vector3d p_c = keyframe->camera_->world2camera(points[i].pos_, keyframe->T_c_w_);
+            if (p_c(2, 0) <= 0)
+                continue;
+            Vector2d pixel = keyframe->camera_->camera2pixel(p_c);
+            // 离网格超过一个格子的投影附近不会有特征点；贴近相机平面的点投影坐标极大，先排除再转成 int
+            if (!(pixel(0, 0) >= -cell && pixel(0, 0) < (grid_cols + 1) * cell &&
+                pixel(1, 0) >= -cell && pixel(1, 0) < (grid_rows + 1) * cell))
+                continue;
+            int cx = int(std::floor(pixel(0, 0) / cell));
+            int cy = int(std::floor(pixel(1, 0) / cell));
+            int best = -1, best_distance = descriptor_distance_ + 1;
+            for (int y = std::max(cy - 1, 0); y <= std::min(cy + 1, grid_rows - 1); y++)
+            {
+                for (int x = std::max(cx - 1, 0); x <= std::min(cx + 1, grid_cols - 1); x++)
+                {
+                    for (int index : grid[y * grid_cols + x])
+                    {
+                        double dx = keypoints[index].pt.x - pixel(0, 0);
+                        double dy = keypoints[index].pt.y - pixel(1, 0);
+                        if (dx * dx + dy * dy > fuse_radius_ * fuse_radius_)
+                            continue;
+                        int distance = cv::norm(points[i].descriptor_, keyframe->descriptors_.row(index), cv::NORM_HAMMING);
+                        if (distance < best_distance)
+                        {
+                            best_distance = distance;
+                            best = index;
+                        }
+                    }
+                }
+            }
+            keypoint_of_point[i] = best;
+        }
+    }
+
+    void MapMaintainer::process(const Job& job, Result& result)
+    {
+        int num_keyframes = job.keyframes_.size();
+        int num_points = job.points_.size();
+        if (num_keyframes == 0)
+            return;
+
+        vector<vector<int>> keypoint_of_point(num_keyframes);
+        for (int k = 0; k < num_keyframes; k++)
+            associate(job.keyframes_[k], job.points_, keypoint_of_point[k]);
+
+        // 合并：在最新关键帧中对应同一特征点且深度相近的点是同一个点，保留匹配次数最多的
+        const Frame::Ptr& newest = job.keyframes_.back();
+        unordered_map<int, vector<int>> points_of_keypoint;
+        for (int i = 0; i < num_points; i++)
+        {
+            if (keypoint_of_point.back()[i] >= 0)
+                points_of_keypoint[keypoint_of_point.back()[i]].push_back(i);
+        }
+        vector<bool> removed(num_points, false);
+        for (auto& candidates : points_of_keypoint)
+        {
+            vector<int>& group = candidates.second;
+            if (group.size() < 2)
+                continue;
+            int keep = group[0];
+            for (int i : group)
+            {
+                const PointData& p = job.points_[i];
+                const PointData& q = job.points_[keep];
+                if (p.matched_times_ > q.matched_times_ || (p.matched_times_ == q.matched_times_ && p.id_ < q.id_))
+                    keep = i;
+            }
+            double keep_depth = newest->camera_->world2camera(job.points_[keep].pos_, newest->T_c_w_)(2, 0);
+            for (int i : group)
+            {
+                if (i == keep)
+                    continue;
+                double depth = newest->camera_->world2camera(job.points_[i].pos_, newest->T_c_w_)(2, 0);
+                if (std::fabs(depth - keep_depth) > depth_ratio_ * keep_depth)
+                    continue;
+                result.fused_.push_back(make_pair(job.points_[keep].id_, job.points_[i].id_));
+                removed[i] = true;
+            }
+        }
+
+        // 剔除：从旧到新检查除最新关键帧外的窗口，若其观测到的点大多也被足够多的其他关键帧观测到则冗余
+        vector<int> observers(num_points, 0);
+        for (int k = 0; k < num_keyframes; k++)
+        {
+            for (int i = 0; i < num_points; i++)
+            {
+                if (keypoint_of_point[k][i] >= 0 && !removed[i])
+                    observers[i]++;
+            }
+        }
+        for (int k = 0; k + 1 < num_keyframes; k++)
+        {
+            int observed = 0, redundant = 0;
+            for (int i = 0; i < num_points; i++)
+            {
+                if (keypoint_of_point[k][i] < 0 || removed[i])
+                    continue;
+                observed++;
+                if (observers[i] - 1 >= min_observers_)
+                    redundant++;
+            }
+            if (observed == 0 || redundant < redundant_ratio_ * observed)
+                continue;
+            result.culled_.push_back(job.keyframes_[k]->id_);
+            // 被剔除的关键帧不再计入观测
+            for (int i = 0; i < num_points; i++)
+            {
+                if (keypoint_of_point[k][i] >= 0 && !removed[i])
+                    observers[i]--;
+            }
+        }
+    }
+}
@@ -16,24 +16,23 @@ namespace myslam
         observed_frames_.push_back(frame);
     }
 
-    MapPoint::Ptr MapPoint::createMapPoint()
+    MapPoint::Ptr MapPoint::createMapPoint(unsigned long id)
     {
         return MapPoint::Ptr(
-            new MapPoint(factory_id_++, Vector3d(0, 0, 0), Vector3d(0, 0, 0))
+            new MapPoint(id, Vector3d(0, 0, 0), Vector3d(0, 0, 0))
         );
     }
 
     MapPoint::Ptr MapPoint::createMapPoint(
+        unsigned long id,
         const Vector3d& pos_world,
         const Vector3d& norm,
         const Mat& descriptor,
         Frame* frame)
     {
         return MapPoint::Ptr(
-            new MapPoint(factory_id_++, pos_world, norm, frame, descriptor)
+            new MapPoint(id, pos_world, norm, frame, descriptor)
         );
     }
 
-    unsigned long MapPoint::factory_id_ = 0;
-
 }
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "myslam/viewer.h"
+
+namespace myslam
+{
+    Viewer::Viewer()
+        : back_(0), middle_(1), front_(2), pending_begin_(0), published_end_(0),
+          stop_(false), submitted_(0), rendered_(0)
+    {
+    }
+
+    Viewer::~Viewer()
+    {
+        stop();
+    }
+
+    void Viewer::start()
+    {
+        stop_ = false;
+        thread_ = std::thread(&Viewer::run, this);
+    }
+
+    void Viewer::stop()
+    {
+        stop_ = true;
+        if (thread_.joinable())
+            thread_.join();
+    }
+
+    void Viewer::update(Frame::Ptr frame, MapSnapshot::Ptr snapshot)
+    {
+        State& state = states_[back_];
+        state.frame_ = frame;
+        state.color_ = frame->color_;
+        state.T_c_w_ = frame->T_c_w_;
+        state.camera_ = frame->camera_;
+        state.snapshot_ = snapshot;
+
+        // 每个位姿都记入轨迹；显示线程还没确认收到的位置随状态一起提交，状态被覆盖也不会在轨迹上留下缺口
+        SE3 Twc = frame->T_c_w_.inverse();
+        pending_.push_back(cv::Point3d(Twc.translation()(0), Twc.translation()(1), Twc.translation()(2)));
+        state.trajectory_ = pending_;
+        state.trajectory_begin_ = pending_begin_;
+        const size_t end = pending_begin_ + pending_.size();
+
+        // 与中间槽交换；若中间槽的状态还没被取走，它就被这次更新覆盖
+        const int previous = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel);
+        back_ = previous & 3;
+        // 换回的槽没有 FRESH 标记，说明上一次提交的状态已被显示线程取走，其中的位置不必再发
+        if ((previous & FRESH) == 0)
+        {
+            pending_.erase(pending_.begin(), pending_.begin() + (published_end_ - pending_begin_));
+            pending_begin_ = published_end_;
+        }
+        published_end_ = end;
+        submitted_++;
+        // 换回的槽里是已显示或被覆盖的旧状态，及早释放它持有的帧
+        states_[back_] = State();
+    }
+
+    bool Viewer::takeFront()
+    {
+        if ((middle_.load(std::memory_order_acquire) & FRESH) == 0)
+            return false;
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & 3;
+        return true;
+    }
+
+    void Viewer::run()
+    {
+        // 窗口在显示线程中创建，事件处理也只在这个线程
+        cv::viz::Viz3d vis("Visual Odometry");
+        cv::viz::WCoordinateSystem world_coor(1.0), camera_coor(0.5);
+        cv::Point3d cam_pos(0, -1.0, -1.0), cam_focal_point(0, 0, 0), cam_y_dir(0, 1, 0);
+        cv::Affine3d cam_pose = cv::viz::makeCameraPose(cam_pos, cam_focal_point, cam_y_dir);
+        vis.setViewerPose(cam_pose);
+
+        world_coor.setRenderingProperty(cv::viz::LINE_WIDTH, 2.0);
+        camera_coor.setRenderingProperty(cv::viz::LINE_WIDTH, 1.0);
+        vis.showWidget("World", world_coor);
+        vis.showWidget("Camera", camera_coor);
+
+        while (!stop_)
+        {
+            // 只显示最新的状态，中间未取走的状态已被覆盖
+            if (takeFront())
+            {
+                render(vis, states_[front_]);
+                states_[front_] = State();
+                rendered_++;
+            }
+            cv::waitKey(1);
+            vis.spinOnce(1, false);
+        }
+        cv::destroyWindow("image");
+        vis.close();
+    }
+
+    void Viewer::render(cv::viz::Viz3d& vis, const State& state)
+    {
+        SE3 Twc = state.T_c_w_.inverse();
+        cv::Affine3d M(
+            cv::Affine3d::Mat3(
+                Twc.rotation_matrix()(0, 0), Twc.rotation_matrix()(0, 1), Twc.rotation_matrix()(0, 2),
+                Twc.rotation_matrix()(1, 0), Twc.rotation_matrix()(1, 1), Twc.rotation_matrix()(1, 2),
+                Twc.rotation_matrix()(2, 0), Twc.rotation_matrix()(2, 1), Twc.rotation_matrix()(2, 2)
+            ),
+            cv::Affine3d::Vec3(
+                Twc.translation()(0, 0), Twc.translation()(1, 0), Twc.translation()(2, 0)
+            )
+        );
+
+        Mat img_show = state.color_.clone();
+        if (state.snapshot_)
+        {
+            for (const Vector3d& pos : state.snapshot_->map_point_positions_)
+            {
+                Vector2d pixel = state.camera_->world2pixel(pos, state.T_c_w_);
+                cv::circle(img_show, cv::Point2f(pixel(0, 0), pixel(1, 0)), 5, cv::Scalar(0, 255, 0), 2);
+            }
+        }
+        cv::imshow("image", img_show);
+
+        vis.setWidgetPose("Camera", M);
+        // 状态里的位置可能与已收到的重叠，只追加新的部分
+        for (size_t i = trajectory_.size(); i < state.trajectory_begin_ + state.trajectory_.size(); i++)
+            trajectory_.push_back(state.trajectory_[i - state.trajectory_begin_]);
+        if (trajectory_.size() >= 2)
+        {
+            cv::viz::WPolyLine trajectory(Mat(trajectory_), cv::viz::Color::green());
+            vis.showWidget("Trajectory", trajectory);
+        }
+    }
+}
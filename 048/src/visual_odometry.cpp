@@ -2,27 +2,74 @@
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/calib3d/calib3d.hpp>
 #include <algorithm>
-#include <boost/timer.hpp>
+#include <chrono>
+#include <Eigen/SVD>
 
 #include "myslam/config.h"
 #include "myslam/visual_odometry.h"
 #include "myslam/g2o_types.h"
+#include "myslam/logger.h"
 
 namespace myslam
 {
-    VisualOdometry::VisualOdometry() :
-        state_(INITIALIZING), ref_(nullptr), curr_(nullptr), map_(new Map), num_lost_(0), num_inliers_(0), matcher_flann_(new cv::flann::LshIndexParams(5, 10, 2))
+    // 单调时钟(秒)，用于统计各阶段耗时
+    static inline double now()
     {
-        num_of_features_ = Config::get<int>("number_of_features");
-        scale_factor_ = Config::get<double>("scale_factor");
-        level_pyramid_ = Config::get<int>("level_pyramid");
-        match_ratio_ = Config::get<float>("match_ratio");
-        max_num_lost_ = Config::get<float>("max_num_lost");
-        min_inliers_ = Config::get<int>("min_inliers");
-        key_frame_min_rot = Config::get<double>("keyframe_rotation");
-        key_frame_min_trans = Config::get<double>("keyframe_translation");
-        map_point_erase_ratio_ = Config::get<double>("map_point_erase_ratio");
+        return std::chrono::duration<double>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // SVD 求解 p_c = R * p_w + t，只使用 indices 中的点对
+    static SE3 alignPoints(const vector<Vector3d>& pts_world, const vector<Vector3d>& pts_camera,
+        const vector<int>& indices)
+    {
+        // 质心
+        Vector3d c_w = Vector3d::Zero(), c_c = Vector3d::Zero();
+        for (int i : indices)
+        {
+            c_w += pts_world[i];
+            c_c += pts_camera[i];
+        }
+        c_w /= indices.size();
+        c_c /= indices.size();
+
+        // W = sum(q_c * q_w^T)
+        Eigen::Matrix3d W = Eigen::Matrix3d::Zero();
+        for (int i : indices)
+            W += (pts_camera[i] - c_c) * (pts_world[i] - c_w).transpose();
+
+        Eigen::JacobiSVD<Eigen::Matrix3d> svd(W, Eigen::ComputeFullU | Eigen::ComputeFullV);
+        Eigen::Matrix3d U = svd.matrixU();
+        Eigen::Matrix3d V = svd.matrixV();
+        Eigen::Matrix3d R = U * V.transpose();
+        // 避免得到反射矩阵
+        if (R.determinant() < 0)
+        {
+            U.col(2) *= -1;
+            R = U * V.transpose();
+        }
+        return SE3(R, c_c - R * c_w);
+    }
+
+    VisualOdometry::VisualOdometry(Config::Ptr config) :
+        state_(INITIALIZING), config_(config), ref_(nullptr), curr_(nullptr), map_(new Map), num_lost_(0), num_inliers_(0), matcher_flann_(new cv::flann::LshIndexParams(5, 10, 2))
+    {
+        num_of_features_ = config_->get<int>("number_of_features");
+        scale_factor_ = config_->get<double>("scale_factor");
+        level_pyramid_ = config_->get<int>("level_pyramid");
+        match_ratio_ = config_->get<float>("match_ratio");
+        max_num_lost_ = config_->get<float>("max_num_lost");
+        min_inliers_ = config_->get<int>("min_inliers");
+        pnp_iterations_ = config_->get<int>("pnp_iterations");
+        optimize_iterations_ = config_->get<int>("optimize_iterations");
+        tracking_mode_ = config_->get<int>("tracking_mode");
+        rgbd_inlier_threshold_ = config_->get<double>("rgbd_inlier_threshold");
+        key_frame_min_rot = config_->get<double>("keyframe_rotation");
+        key_frame_min_trans = config_->get<double>("keyframe_translation");
+        map_point_erase_ratio_ = config_->get<double>("map_point_erase_ratio");
         orb_ = cv::ORB::create(num_of_features_, scale_factor_, level_pyramid_);
+        if (config_->get<int>("maintenance.enable"))
+            maintainer_.reset(new MapMaintainer(config_));
     }
 
     VisualOdometry::~VisualOdometry()
@@ -30,9 +77,19 @@ namespace myslam
 
     }
 
+    void VisualOdometry::setFeatureParams(int num_of_features, int level_pyramid)
+    {
+        num_of_features_ = num_of_features;
+        level_pyramid_ = level_pyramid;
+        orb_->setMaxFeatures(num_of_features_);
+        orb_->setNLevels(level_pyramid_);
+    }
+
     // 添加帧
     bool VisualOdometry::addFrame(Frame::Ptr frame)
     {
+        timings_ = StageTimings();
+        frame->id_ = map_->newFrameId();
         switch (state_)
         {
         case INITIALIZING:
@@ -42,19 +99,28 @@ namespace myslam
             // 从第一帧中提取特征并加入地图中
             extractKeyPoints();
             computeDescriptors();
+            double start = now();
             addKeyFrame();        // 第一帧为关键帧
+            timings_.map_ = now() - start;
             break;
         }
         case OK:
         {
+            // 应用后台维护的结果，地图只在跟踪线程中修改
+            if (maintainer_)
+                maintainer_->apply(map_, ref_);
             curr_ = frame;
             curr_->T_c_w_ = ref_->T_c_w_;
             extractKeyPoints();
             computeDescriptors();
             featureMatching();
-            poseEstimationPnP();
+            if (tracking_mode_ == RGBD)
+                poseEstimationRGBD();
+            else
+                poseEstimationPnP();
             if (checkEstimatedPose() == true) // 一个好的评估?
             {
+                double start = now();
                 curr_->T_c_w_ = T_c_w_estimated_;
                 optimizeMap();
                 num_lost_ = 0;
@@ -62,6 +128,7 @@ namespace myslam
                 {
                     addKeyFrame();
                 }
+                timings_.map_ = now() - start;
             }
             else // 由于种种原因造成的估计错误
             {
@@ -76,34 +143,37 @@ namespace myslam
         }
         case LOST:
         {
-            cout << "vo has lost." << endl;
+            MYSLAM_WARN("vo has lost.");
             break;
         }
         }
 
+        map_->publishSnapshot();
         return true;
     }
 
     // 提取关键点
     void VisualOdometry::extractKeyPoints()
     {
-        boost::timer timer;
+        double start = now();
         orb_->detect(curr_->color_, keypoints_curr_);
-        cout << "extract keypoints cost time: " << timer.elapsed() << endl;
+        timings_.extract_ = now() - start;
+        MYSLAM_DEBUG("extract keypoints cost time: %f", timings_.extract_);
     }
 
     // 计算描述子
     void VisualOdometry::computeDescriptors()
     {
-        boost::timer timer;
+        double start = now();
         orb_->compute(curr_->color_, keypoints_curr_, descriptors_curr_);
-        cout << "descriptor computation cost time: " << timer.elapsed() << endl;
+        timings_.descriptor_ = now() - start;
+        MYSLAM_DEBUG("descriptor computation cost time: %f", timings_.descriptor_);
     }
 
     // 特征匹配
     void VisualOdometry::featureMatching()
     {
-        boost::timer timer;
+        double start = now();
         vector<cv::DMatch> matches;
         // 在map中选择候选项
         Mat desp_map;
@@ -140,13 +210,15 @@ namespace myslam
                 match_2dkp_index_.push_back(m.trainIdx);
             }
         }
-        cout << "good matches: " << match_3dpts_.size() << endl;
-        cout << "match cost time: " << timer.elapsed() << endl;
+        MYSLAM_DEBUG("good matches: %zu", match_3dpts_.size());
+        timings_.match_ = now() - start;
+        MYSLAM_DEBUG("match cost time: %f", timings_.match_);
     }
 
     // 姿态估计
     void VisualOdometry::poseEstimationPnP()
     {
+        double start = now();
         // 构建3d、2d观测
         vector<cv::Point3f> pts3d;
         vector<cv::Point2f> pts2d;
@@ -166,9 +238,9 @@ namespace myslam
             0, 0, 1
             );
         Mat rvec, tvec, inliers;
-        cv::solvePnPRansac(pts3d, pts2d, K, Mat(), rvec, tvec, false, 100, 4.0, 0.99, inliers);
+        cv::solvePnPRansac(pts3d, pts2d, K, Mat(), rvec, tvec, false, pnp_iterations_, 4.0, 0.99, inliers);
         num_inliers_ = inliers.rows;
-        cout << "pnp inliers: " << num_inliers_ << endl;
+        MYSLAM_DEBUG("pnp inliers: %d", num_inliers_);
         T_c_w_estimated_ = SE3(
             SO3(rvec.at<double>(0, 0), rvec.at<double>(1, 0), rvec.at<double>(2, 0)),
             Vector3d(tvec.at<double>(0, 0), tvec.at<double>(1, 0), tvec.at<double>(2, 0))
@@ -210,14 +282,128 @@ namespace myslam
         }
 
         optimizer.initializeOptimization();
-        optimizer.optimize(10);
+        optimizer.optimize(optimize_iterations_);
 
         T_c_w_estimated_ = SE3(
             pose->estimate().rotation(),
             pose->estimate().translation()
         );
 
-        cout << "T_c_w_estimated_: " << endl << T_c_w_estimated_.matrix() << endl;
+        timings_.pose_ = now() - start;
+        // 平移和四元数一行输出，代替逐行打印 4x4 矩阵
+        MYSLAM_DEBUG("T_c_w_estimated_: t %f %f %f q %f %f %f %f",
+            T_c_w_estimated_.translation()(0), T_c_w_estimated_.translation()(1), T_c_w_estimated_.translation()(2),
+            T_c_w_estimated_.unit_quaternion().x(), T_c_w_estimated_.unit_quaternion().y(),
+            T_c_w_estimated_.unit_quaternion().z(), T_c_w_estimated_.unit_quaternion().w());
+    }
+
+    // 3D-3D 姿态估计：当前帧深度反投影，三点 RANSAC + SVD 对齐，再用 3D-3D 边优化
+    void VisualOdometry::poseEstimationRGBD()
+    {
+        double start = now();
+        // 构建 3d-3d 点对，没有深度的匹配直接跳过
+        vector<Vector3d> pts_world, pts_camera;
+        vector<int> match_index;    // 点对在 match_3dpts_ 中的下标
+        for (size_t i = 0; i < match_2dkp_index_.size(); i++)
+        {
+            const cv::KeyPoint& kp = keypoints_curr_[match_2dkp_index_[i]];
+            double d = curr_->findDepth(kp);
+            if (d < 0)
+                continue;
+            pts_world.push_back(match_3dpts_[i]->pos_);
+            pts_camera.push_back(curr_->camera_->pixel2camera(Vector2d(kp.pt.x, kp.pt.y), d));
+            match_index.push_back(i);
+        }
+
+        num_inliers_ = 0;
+        int n = pts_world.size();
+        if (n < 3)
+        {
+            timings_.pose_ = now() - start;
+            return;
+        }
+
+        // RANSAC：最小样本 3 点，按当前最好的内点率自适应减少迭代次数
+        vector<int> sample(3), inliers, best_inliers;
+        std::uniform_int_distribution<int> pick(0, n - 1);
+        int max_iterations = pnp_iterations_;
+        int iterations = 0;
+        for (; iterations < max_iterations; iterations++)
+        {
+            sample[0] = pick(rng_);
+            sample[1] = pick(rng_);
+            sample[2] = pick(rng_);
+            if (sample[0] == sample[1] || sample[0] == sample[2] || sample[1] == sample[2])
+                continue;
+            // 三点近似共线时旋转不确定
+            Vector3d a = pts_world[sample[1]] - pts_world[sample[0]];
+            Vector3d b = pts_world[sample[2]] - pts_world[sample[0]];
+            if (a.cross(b).norm() < 1e-4)
+                continue;
+
+            SE3 T = alignPoints(pts_world, pts_camera, sample);
+            inliers.clear();
+            for (int i = 0; i < n; i++)
+            {
+                if ((pts_camera[i] - T * pts_world[i]).norm() < rgbd_inlier_threshold_)
+                    inliers.push_back(i);
+            }
+            if (inliers.size() > best_inliers.size())
+            {
+                best_inliers.swap(inliers);
+                double w = double(best_inliers.size()) / n;
+                double needed = std::log(1 - 0.99) / std::log(1 - w * w * w);
+                if (needed < max_iterations)
+                    max_iterations = int(std::ceil(needed));
+            }
+        }
+        num_inliers_ = best_inliers.size();
+        MYSLAM_DEBUG("rgbd inliers: %d of %d, ransac iterations: %d", num_inliers_, n, iterations);
+        if (num_inliers_ < 3)
+        {
+            timings_.pose_ = now() - start;
+            return;
+        }
+        // 用全部内点重新对齐
+        T_c_w_estimated_ = alignPoints(pts_world, pts_camera, best_inliers);
+
+        // 优化姿态
+        typedef g2o::BlockSolver<g2o::BlockSolverTraits<6, 3>> Block;
+        Block::LinearSolverType* linearSolver = new g2o::LinearSolverDense<Block::PoseMatrixType>();
+        Block* solver_ptr = new Block(std::unique_ptr<Block::LinearSolverType>(linearSolver));
+        g2o::OptimizationAlgorithmLevenberg* solver = new g2o::OptimizationAlgorithmLevenberg(std::unique_ptr<Block>(solver_ptr));
+        g2o::SparseOptimizer optimizer;
+        optimizer.setAlgorithm(solver);
+
+        g2o::VertexSE3Expmap* pose = new g2o::VertexSE3Expmap();
+        pose->setId(0);
+        pose->setEstimate(g2o::SE3Quat(
+            T_c_w_estimated_.rotation_matrix(), T_c_w_estimated_.translation()
+        ));
+        optimizer.addVertex(pose);
+
+        // 3D -> 3D 边
+        for (size_t i = 0; i < best_inliers.size(); i++)
+        {
+            int index = best_inliers[i];
+            EdgeProjectXYZRGBDPoseOnly* edge = new EdgeProjectXYZRGBDPoseOnly();
+            edge->setId(i);
+            edge->setVertex(0, pose);
+            edge->point_ = pts_world[index];
+            edge->setMeasurement(pts_camera[index]);
+            edge->setInformation(Eigen::Matrix3d::Identity());
+            optimizer.addEdge(edge);
+            match_3dpts_[match_index[index]]->matched_times_++;
+        }
+
+        optimizer.initializeOptimization();
+        optimizer.optimize(optimize_iterations_);
+
+        T_c_w_estimated_ = SE3(
+            pose->estimate().rotation(),
+            pose->estimate().translation()
+        );
+        timings_.pose_ = now() - start;
     }
 
     // 检查估计姿势
@@ -226,7 +412,7 @@ namespace myslam
         // 检查预估姿势是否正确
         if (num_inliers_ < min_inliers_)
         {
-            cout << "reject because inlier is too small: " << num_inliers_ << endl;
+            MYSLAM_DEBUG("reject because inlier is too small: %d", num_inliers_);
             return false;
         }
         // 如果运动太大，它可能是错误的
@@ -234,7 +420,7 @@ namespace myslam
         Sophus::Vector6d d = T_r_c.log();
         if (d.norm() > 5.0)
         {
-            cout << "reject because motion is too large: " << d.norm() << endl;
+            MYSLAM_DEBUG("reject because motion is too large: %f", d.norm());
             return false;
         }
         return true;
@@ -268,14 +454,21 @@ namespace myslam
                 Vector3d n = p_world - ref_->getCamCenter();
                 n.normalize();
                 MapPoint::Ptr map_point = MapPoint::createMapPoint(
+                    map_->newMapPointId(),
                     p_world, n, descriptors_curr_.row(i).clone(), curr_.get()
                 );
                 map_->insertMapPoint(map_point);
             }
         }
 
+        curr_->is_key_frame_ = true;
+        // 保存特征供地图维护使用，descriptors_curr_ 的缓冲区下一帧会被复用
+        curr_->keypoints_ = keypoints_curr_;
+        curr_->descriptors_ = descriptors_curr_.clone();
         map_->insertKeyFrame(curr_);
         ref_ = curr_;
+        if (maintainer_)
+            maintainer_->submit(map_, curr_);
     }
 
     // 添加地图点
@@ -299,6 +492,7 @@ namespace myslam
             Vector3d n = p_world - ref_->getCamCenter();
             n.normalize();
             MapPoint::Ptr map_point = MapPoint::createMapPoint(
+                map_->newMapPointId(),
                 p_world, n, descriptors_curr_.row(i).clone(), curr_.get()
             );
             map_->insertMapPoint(map_point);
@@ -345,7 +539,7 @@ namespace myslam
         }
         else
             map_point_erase_ratio_ = 0.1;
-        cout << "map points: " << map_->map_points_.size() << endl;
+        MYSLAM_DEBUG("map points: %zu", map_->map_points_.size());
     }
 
     // 获取视角
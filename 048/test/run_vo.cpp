@@ -1,13 +1,14 @@
 // -------------- test the visual odometry -------------
 #include <fstream>
-#include <boost/timer.hpp>
+#include <chrono>
 #include <opencv2/imgcodecs.hpp>
-#include <opencv2/highgui/highgui.hpp>
-#include <opencv2/viz.hpp>
-#include <opencv2/imgproc/imgproc.hpp>
 
 #include "myslam/config.h"
 #include "myslam/visual_odometry.h"
+#include "myslam/frame_pool.h"
+#include "myslam/adaptive_scheduler.h"
+#include "myslam/logger.h"
+#include "myslam/viewer.h"
 
 int main ( int argc, char** argv )
 {
@@ -17,10 +18,19 @@ int main ( int argc, char** argv )
         return 1;
     }
 
-    myslam::Config::setParameterFile ( argv[1] );
-    myslam::VisualOdometry::Ptr vo ( new myslam::VisualOdometry );
+    myslam::Config::Ptr config = myslam::Config::create ( argv[1] );
+    if ( config==nullptr )
+        return 1;
+    myslam::Logger::instance().setLevel ( config->get<int> ( "log_level" ) );
+    myslam::VisualOdometry::Ptr vo ( new myslam::VisualOdometry ( config ) );
+
+    // 单帧时间预算，大于 0 时按预算在线调整 VO 参数
+    myslam::AdaptiveScheduler::Ptr scheduler;
+    double frame_budget = config->get<double> ( "frame_budget" );
+    if ( frame_budget > 0 )
+        scheduler.reset ( new myslam::AdaptiveScheduler ( vo, frame_budget ) );
 
-    string dataset_dir = myslam::Config::get<string> ( "dataset_dir" );
+    string dataset_dir = config->get<string> ( "dataset_dir" );
     cout<<"dataset: "<<dataset_dir<<endl;
     ifstream fin ( dataset_dir+"/associate.txt" );
     if ( !fin )
@@ -44,68 +54,67 @@ int main ( int argc, char** argv )
             break;
     }
 
-    myslam::Camera::Ptr camera ( new myslam::Camera );
+    myslam::Camera::Ptr camera ( new myslam::Camera ( config ) );
 
-    // visualization
-    cv::viz::Viz3d vis ( "Visual Odometry" );
-    cv::viz::WCoordinateSystem world_coor ( 1.0 ), camera_coor ( 0.5 );
-    cv::Point3d cam_pos ( 0, -1.0, -1.0 ), cam_focal_point ( 0,0,0 ), cam_y_dir ( 0,1,0 );
-    cv::Affine3d cam_pose = cv::viz::makeCameraPose ( cam_pos, cam_focal_point, cam_y_dir );
-    vis.setViewerPose ( cam_pose );
+    // 帧对象池，缓冲区按第一帧的尺寸预分配
+    Mat first = cv::imread ( rgb_files[0] );
+    if ( first.data==nullptr )
+        return 1;
+    myslam::FramePool::Ptr frame_pool ( new myslam::FramePool (
+        first.rows, first.cols, config->get<int> ( "frame_pool_size" ) ) );
 
-    world_coor.setRenderingProperty ( cv::viz::LINE_WIDTH, 2.0 );
-    camera_coor.setRenderingProperty ( cv::viz::LINE_WIDTH, 1.0 );
-    vis.showWidget ( "World", world_coor );
-    vis.showWidget ( "Camera", camera_coor );
+    // 显示在独立线程中进行，不影响跟踪
+    myslam::Viewer::Ptr viewer;
+    if ( config->get<int> ( "viewer.enable" ) )
+    {
+        viewer.reset ( new myslam::Viewer );
+        viewer->start();
+    }
 
     cout<<"read total "<<rgb_files.size() <<" entries"<<endl;
+    // 用墙上时间计时，进程 CPU 时间会把显示线程也算进来
+    double vo_time = 0;
+    int vo_frames = 0;
     for ( int i=0; i<rgb_files.size(); i++ )
     {
-        cout<<"****** loop "<<i<<" ******"<<endl;
-        Mat color = cv::imread ( rgb_files[i] );
-        Mat depth = cv::imread ( depth_files[i], -1 );
-        if ( color.data==nullptr || depth.data==nullptr )
+        MYSLAM_DEBUG ( "****** loop %d ******", i );
+        myslam::Frame::Ptr pFrame = frame_pool->acquire();
+        if ( !frame_pool->readImages ( pFrame, rgb_files[i], depth_files[i] ) )
             break;
-        myslam::Frame::Ptr pFrame = myslam::Frame::createFrame();
         pFrame->camera_ = camera;
-        pFrame->color_ = color;
-        pFrame->depth_ = depth;
         pFrame->time_stamp_ = rgb_times[i];
 
-        boost::timer timer;
+        chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
         vo->addFrame ( pFrame );
-        cout<<"VO costs time: "<<timer.elapsed() <<endl;
+        chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+        double cost = chrono::duration_cast<chrono::duration<double>> ( t2-t1 ).count();
+        vo_time += cost;
+        vo_frames++;
+        MYSLAM_DEBUG ( "VO costs time: %f", cost );
+        if ( scheduler && scheduler->update() )
+            MYSLAM_DEBUG ( "frame over budget, degraded: %d", int ( scheduler->degraded() ) );
+        // 只有关键帧需要长期保存图像，其余帧用完回到池中
+        if ( pFrame->is_key_frame_ )
+            frame_pool->promote ( pFrame );
 
         if ( vo->state_ == myslam::VisualOdometry::LOST )
             break;
-        SE3 Twc = pFrame->T_c_w_.inverse();
 
-        // show the map and the camera pose
-        cv::Affine3d M (
-            cv::Affine3d::Mat3 (
-                Twc.rotation_matrix() ( 0,0 ), Twc.rotation_matrix() ( 0,1 ), Twc.rotation_matrix() ( 0,2 ),
-                Twc.rotation_matrix() ( 1,0 ), Twc.rotation_matrix() ( 1,1 ), Twc.rotation_matrix() ( 1,2 ),
-                Twc.rotation_matrix() ( 2,0 ), Twc.rotation_matrix() ( 2,1 ), Twc.rotation_matrix() ( 2,2 )
-            ),
-            cv::Affine3d::Vec3 (
-                Twc.translation() ( 0,0 ), Twc.translation() ( 1,0 ), Twc.translation() ( 2,0 )
-            )
-        );
-
-        Mat img_show = color.clone();
-        for ( auto& pt:vo->map_->map_points_ )
-        {
-            myslam::MapPoint::Ptr p = pt.second;
-            Vector2d pixel = pFrame->camera_->world2pixel ( p->pos_, pFrame->T_c_w_ );
-            cv::circle ( img_show, cv::Point2f ( pixel ( 0,0 ),pixel ( 1,0 ) ), 5, cv::Scalar ( 0,255,0 ), 2 );
-        }
-
-        cv::imshow ( "image", img_show );
-        cv::waitKey ( 1 );
-        vis.setWidgetPose ( "Camera", M );
-        vis.spinOnce ( 1, false );
-        cout<<endl;
+        // 提交给显示线程后立即处理下一帧
+        if ( viewer )
+            viewer->update ( pFrame, vo->map_->snapshot() );
+    }
+    if ( viewer )
+    {
+        viewer->stop();
+        cout<<"viewer rendered "<<viewer->rendered() <<" of "<<viewer->submitted() <<" frames"<<endl;
     }
+    if ( vo_frames > 0 )
+        cout<<"tracked "<<vo_frames<<" frames, "<<vo_frames/vo_time<<" fps"<<endl;
+    cout<<"frame pool allocated "<<frame_pool->numBuffers() <<" image buffers"<<endl;
+    if ( scheduler )
+        cout<<"frames over budget: "<<scheduler->over_budget_frames_
+            <<", frames with degraded parameters: "<<scheduler->degraded_frames_<<endl;
 
     return 0;
 }
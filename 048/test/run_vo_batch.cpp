@@ -0,0 +1,130 @@
+// -------------- run several independent visual odometry instances in parallel -------------
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <opencv2/imgcodecs.hpp>
+
+#include "myslam/config.h"
+#include "myslam/dataset.h"
+#include "myslam/visual_odometry.h"
+#include "myslam/frame_pool.h"
+#include "myslam/logger.h"
+
+// 一组参数/一个数据集的运行结果
+struct RunResult
+{
+    string  parameter_file;
+    bool    started = false;    // 配置与数据集是否读取成功
+    int     frames = 0;         // 读入的帧数
+    int     tracked = 0;        // 跟踪成功的帧数
+    bool    lost = false;
+    double  seconds = 0;
+};
+
+// 用独立的配置、相机和 VO 实例跑完一个序列，轨迹按 TUM 格式写入 trajectory_file
+static void runSequence ( const string& parameter_file, const string& trajectory_file, RunResult& result )
+{
+    result.parameter_file = parameter_file;
+    myslam::Config::Ptr config = myslam::Config::create ( parameter_file );
+    if ( config==nullptr )
+        return;
+    myslam::Dataset dataset ( config->get<string> ( "dataset_dir" ) );
+    if ( !dataset.load() || dataset.size() == 0 )
+        return;
+    Mat first = cv::imread ( dataset.rgb_files_[0] );
+    if ( first.data==nullptr )
+        return;
+    result.started = true;
+
+    myslam::Camera::Ptr camera ( new myslam::Camera ( config ) );
+    myslam::VisualOdometry::Ptr vo ( new myslam::VisualOdometry ( config ) );
+    myslam::FramePool::Ptr frame_pool ( new myslam::FramePool (
+        first.rows, first.cols, config->get<int> ( "frame_pool_size" ) ) );
+    ofstream fout ( trajectory_file );
+
+    chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+    for ( size_t i=0; i<dataset.size(); i++ )
+    {
+        myslam::Frame::Ptr frame = frame_pool->acquire();
+        if ( !frame_pool->readImages ( frame, dataset.rgb_files_[i], dataset.depth_files_[i] ) )
+            break;
+        frame->camera_ = camera;
+        frame->time_stamp_ = dataset.rgb_times_[i];
+        result.frames++;
+
+        bool ok = vo->addFrame ( frame );
+        if ( vo->state_ == myslam::VisualOdometry::LOST )
+        {
+            result.lost = true;
+            break;
+        }
+        if ( frame->is_key_frame_ )
+            frame_pool->promote ( frame );
+        if ( !ok )
+            continue;
+
+        result.tracked++;
+        SE3 Twc = frame->T_c_w_.inverse();
+        Eigen::Quaterniond q = Twc.unit_quaternion();
+        fout<<fixed<<frame->time_stamp_<<" "
+            <<Twc.translation() ( 0 ) <<" "<<Twc.translation() ( 1 ) <<" "<<Twc.translation() ( 2 ) <<" "
+            <<q.x() <<" "<<q.y() <<" "<<q.z() <<" "<<q.w() <<endl;
+    }
+    chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+    result.seconds = chrono::duration_cast<chrono::duration<double>> ( t2-t1 ).count();
+}
+
+int main ( int argc, char** argv )
+{
+    if ( argc < 2 )
+    {
+        cout<<"usage: run_vo_batch parameter_file [parameter_file ...]"<<endl;
+        return 1;
+    }
+
+    // 每个参数文件是一个独立任务，例如参数扫描或多个数据集
+    vector<string> jobs ( argv+1, argv+argc );
+    vector<RunResult> results ( jobs.size() );
+
+    // 日志是进程内共享的，级别只在开始前按第一个参数文件设置一次，各实例的 log_level 不再生效
+    myslam::Config::Ptr first_config = myslam::Config::create ( jobs[0] );
+    if ( first_config!=nullptr )
+        myslam::Logger::instance().setLevel ( first_config->get<int> ( "log_level" ) );
+
+    // 并行度来自实例间，OpenCV 内部不再开线程
+    cv::setNumThreads ( 1 );
+    int num_workers = std::max ( 1u, std::min ( std::thread::hardware_concurrency(), unsigned ( jobs.size() ) ) );
+    cout<<"running "<<jobs.size() <<" sequences on "<<num_workers<<" threads"<<endl;
+
+    std::atomic<int> next_job ( 0 );
+    vector<std::thread> workers;
+    chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+    for ( int w=0; w<num_workers; w++ )
+    {
+        workers.push_back ( std::thread ( [&]()
+        {
+            for ( int k=next_job++; k<int ( jobs.size() ); k=next_job++ )
+                runSequence ( jobs[k], "trajectory_"+to_string ( k ) +".txt", results[k] );
+        } ) );
+    }
+    for ( std::thread& worker : workers )
+        worker.join();
+    chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+
+    for ( size_t k=0; k<jobs.size(); k++ )
+    {
+        const RunResult& r = results[k];
+        if ( !r.started )
+        {
+            cout<<"["<<k<<"] "<<jobs[k]<<": failed to start"<<endl;
+            continue;
+        }
+        cout<<"["<<k<<"] "<<r.parameter_file<<": tracked "<<r.tracked<<"/"<<r.frames
+            <<" frames in "<<r.seconds<<" s"<<( r.lost ? ", lost" : "" )
+            <<" -> trajectory_"<<k<<".txt"<<endl;
+    }
+    cout<<"total time: "<<chrono::duration_cast<chrono::duration<double>> ( t2-t1 ).count() <<" s"<<endl;
+    return 0;
+}
@@ -0,0 +1,90 @@
+// -------------- run the visual odometry against a real-time replay clock -------------
+#include <thread>
+#include <algorithm>
+#include <opencv2/imgcodecs.hpp>
+
+#include "myslam/config.h"
+#include "myslam/dataset.h"
+#include "myslam/visual_odometry.h"
+#include "myslam/frame_pool.h"
+#include "myslam/frame_queue.h"
+#include "myslam/logger.h"
+
+int main ( int argc, char** argv )
+{
+    if ( argc != 2 )
+    {
+        cout<<"usage: run_vo_realtime parameter_file"<<endl;
+        return 1;
+    }
+
+    myslam::Config::Ptr config = myslam::Config::create ( argv[1] );
+    if ( config==nullptr )
+        return 1;
+    myslam::Logger::instance().setLevel ( config->get<int> ( "log_level" ) );
+    myslam::VisualOdometry::Ptr vo ( new myslam::VisualOdometry ( config ) );
+
+    myslam::Dataset dataset ( config->get<string> ( "dataset_dir" ) );
+    if ( !dataset.load() || dataset.size() == 0 )
+    {
+        cout<<"please generate the associate file called associate.txt!"<<endl;
+        return 1;
+    }
+
+    myslam::Camera::Ptr camera ( new myslam::Camera ( config ) );
+    Mat first = cv::imread ( dataset.rgb_files_[0] );
+    if ( first.data==nullptr )
+        return 1;
+    myslam::FramePool::Ptr frame_pool ( new myslam::FramePool (
+        first.rows, first.cols, config->get<int> ( "frame_pool_size" ) ) );
+
+    myslam::ReplayClock clock ( config->get<double> ( "replay.rate" ) );
+    myslam::FrameQueue queue (
+        config->get<int> ( "queue.capacity" ),
+        myslam::FrameQueue::OverloadPolicy ( config->get<int> ( "queue.policy" ) ) );
+
+    // 模拟相机：按时间戳节奏把帧送入队列，不等待 VO
+    clock.start ( dataset.rgb_times_[0] );
+    std::thread camera_thread ( [&]()
+    {
+        for ( size_t i=0; i<dataset.size(); i++ )
+        {
+            myslam::Frame::Ptr frame = frame_pool->acquire();
+            if ( !frame_pool->readImages ( frame, dataset.rgb_files_[i], dataset.depth_files_[i] ) )
+                break;
+            frame->camera_ = camera;
+            frame->time_stamp_ = dataset.rgb_times_[i];
+            clock.waitUntil ( frame->time_stamp_ );
+            queue.push ( frame, myslam::ReplayClock::now() );
+        }
+        queue.close();
+    } );
+
+    // 端到端延迟：帧到达到位姿输出
+    vector<double> latencies;
+    myslam::FrameQueue::Item item;
+    while ( queue.pop ( item ) )
+    {
+        if ( vo->state_ == myslam::VisualOdometry::LOST )
+            continue;
+        vo->addFrame ( item.frame_ );
+        latencies.push_back ( myslam::ReplayClock::now() - item.arrival_ );
+        if ( item.frame_->is_key_frame_ )
+            frame_pool->promote ( item.frame_ );
+    }
+    camera_thread.join();
+
+    cout<<"frames: "<<queue.pushed() <<", processed "<<latencies.size()
+        <<", dropped "<<queue.dropped() <<endl;
+    if ( !latencies.empty() )
+    {
+        double sum = 0;
+        for ( double l : latencies )
+            sum += l;
+        std::sort ( latencies.begin(), latencies.end() );
+        cout<<"pose latency: mean "<<sum/latencies.size() *1000
+            <<" ms, p95 "<<latencies[latencies.size() *95/100] *1000
+            <<" ms, max "<<latencies.back() *1000<<" ms"<<endl;
+    }
+    return 0;
+}
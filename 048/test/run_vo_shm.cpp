@@ -0,0 +1,77 @@
+// -------------- run the visual odometry on frames from shared memory -------------
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#include "myslam/config.h"
+#include "myslam/visual_odometry.h"
+#include "myslam/frame_transport.h"
+#include "myslam/logger.h"
+
+int main ( int argc, char** argv )
+{
+    if ( argc != 2 && !( argc == 3 && string ( argv[2] ) == "--bench" ) )
+    {
+        cout<<"usage: run_vo_shm parameter_file [--bench]"<<endl;
+        return 1;
+    }
+    // --bench 只测传输，不运行 VO
+    bool bench_only = argc == 3;
+
+    myslam::Config::Ptr config = myslam::Config::create ( argv[1] );
+    if ( config==nullptr )
+        return 1;
+    myslam::Logger::instance().setLevel ( config->get<int> ( "log_level" ) );
+    string shm_name = config->get<string> ( "transport.name" );
+
+    // 等待生产者创建共享内存
+    myslam::FrameTransport::Ptr transport;
+    for ( int retry=0; retry<1000 && transport==nullptr; retry++ )
+    {
+        transport = myslam::FrameTransport::open ( shm_name );
+        if ( transport==nullptr )
+            std::this_thread::sleep_for ( std::chrono::milliseconds ( 10 ) );
+    }
+    if ( transport==nullptr )
+    {
+        cout<<"cannot open shared memory "<<shm_name<<", start shm_producer first"<<endl;
+        return 1;
+    }
+    cout<<"connected to "<<shm_name<<": "<<transport->numSlots() <<" slots of "
+        <<transport->cols() <<"x"<<transport->rows() <<endl;
+
+    myslam::Camera::Ptr camera ( new myslam::Camera ( config ) );
+    myslam::VisualOdometry::Ptr vo ( new myslam::VisualOdometry ( config ) );
+    myslam::SharedMemoryFrameSource source ( transport, camera );
+
+    long frames = 0;
+    double latency_sum = 0, latency_max = 0, checksum = 0;
+    double start_time = myslam::FrameTransport::now();
+    while ( myslam::Frame::Ptr frame = source.grab() )
+    {
+        frames++;
+        latency_sum += source.lastLatency();
+        latency_max = std::max ( latency_max, source.lastLatency() );
+        if ( bench_only )
+        {
+            // 读一行像素，确认数据可以直接访问
+            const uchar* row = frame->color_.ptr<uchar> ( frame->color_.rows/2 );
+            for ( int x=0; x<frame->color_.cols*3; x++ )
+                checksum += row[x];
+            continue;
+        }
+
+        // 跟丢后继续取帧，让生产者能够结束
+        if ( vo->state_ != myslam::VisualOdometry::LOST )
+            vo->addFrame ( frame );
+    }
+
+    double elapsed = myslam::FrameTransport::now() - start_time;
+    cout<<"received "<<frames<<" frames in "<<elapsed<<" s, "<<frames/elapsed<<" fps"<<endl;
+    if ( frames > 0 )
+        cout<<"transport latency: mean "<<latency_sum/frames*1000<<" ms, max "
+            <<latency_max*1000<<" ms"<<endl;
+    if ( bench_only )
+        cout<<"checksum: "<<checksum<<endl;
+    return 0;
+}
@@ -0,0 +1,123 @@
+// -------------- replay a TUM sequence into the shared memory frame ring -------------
+#include <chrono>
+#include <thread>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include "myslam/config.h"
+#include "myslam/dataset.h"
+#include "myslam/frame_transport.h"
+
+int main ( int argc, char** argv )
+{
+    // --force 删除上次异常退出遗留的同名共享内存段
+    bool force = argc == 3 && string ( argv[2] ) == "--force";
+    if ( argc != 2 && !force )
+    {
+        cout<<"usage: shm_producer parameter_file [--force]"<<endl;
+        return 1;
+    }
+
+    myslam::Config::Ptr config = myslam::Config::create ( argv[1] );
+    if ( config==nullptr )
+        return 1;
+    string dataset_dir = config->get<string> ( "dataset_dir" );
+    string shm_name = config->get<string> ( "transport.name" );
+    int num_slots = config->get<int> ( "transport.num_slots" );
+    double replay_rate = config->get<double> ( "transport.replay_rate" );
+    // 消费者超过这么多秒没有释放任何槽，认为它已退出
+    double timeout = config->get<double> ( "transport.timeout" );
+    if ( timeout <= 0 )
+        timeout = 10.0;
+
+    myslam::Dataset dataset ( dataset_dir );
+    if ( !dataset.load() || dataset.size() == 0 )
+    {
+        cout<<"please generate the associate file called associate.txt!"<<endl;
+        return 1;
+    }
+
+    // 用第一帧确定图像尺寸
+    Mat first = cv::imread ( dataset.rgb_files_[0] );
+    if ( first.data==nullptr )
+        return 1;
+    myslam::FrameTransport::Ptr transport = myslam::FrameTransport::create (
+        shm_name, num_slots, first.rows, first.cols, force );
+    if ( transport==nullptr )
+        return 1;
+    cout<<"publishing "<<dataset.size() <<" frames to "<<shm_name<<endl;
+
+    // replay_rate > 0 时按时间戳节奏回放，否则尽快发送
+    double start_time = myslam::FrameTransport::now();
+    double first_stamp = dataset.rgb_times_[0];
+    long full_waits = 0, published = 0, skipped = 0;
+    for ( size_t i=0; i<dataset.size(); i++ )
+    {
+        Mat color = cv::imread ( dataset.rgb_files_[i] );
+        Mat depth = cv::imread ( dataset.depth_files_[i], -1 );
+        if ( color.data==nullptr || depth.data==nullptr )
+            break;
+        // 槽的尺寸和类型由第一帧决定，不一致时 copyTo 会重新分配内存，数据写不进共享内存
+        if ( color.rows!=transport->rows() || color.cols!=transport->cols() || color.type()!=CV_8UC3
+            || depth.rows!=transport->rows() || depth.cols!=transport->cols() || depth.type()!=CV_16UC1 )
+        {
+            cerr<<"frame "<<i<<" does not match the ring slots ("<<transport->cols() <<"x"<<transport->rows()
+                <<", CV_8UC3 color and CV_16UC1 depth), skipped"<<endl;
+            skipped++;
+            continue;
+        }
+
+        if ( replay_rate > 0 )
+        {
+            double due = start_time + ( dataset.rgb_times_[i]-first_stamp ) /replay_rate;
+            double wait = due - myslam::FrameTransport::now();
+            if ( wait > 0 )
+                std::this_thread::sleep_for ( std::chrono::duration<double> ( wait ) );
+        }
+
+        // 环形缓冲区满时等待消费者释放槽
+        Mat slot_color, slot_depth;
+        double wait_start = myslam::FrameTransport::now();
+        while ( !transport->beginWrite ( slot_color, slot_depth ) )
+        {
+            if ( myslam::FrameTransport::now() - wait_start > timeout )
+            {
+                cerr<<"no slot released for "<<timeout<<" s, the consumer seems to be gone"<<endl;
+                transport->close();
+                return 1;
+            }
+            full_waits++;
+            std::this_thread::sleep_for ( std::chrono::microseconds ( 100 ) );
+        }
+        color.copyTo ( slot_color );
+        depth.copyTo ( slot_depth );
+        transport->endWrite ( dataset.rgb_times_[i] );
+        published++;
+    }
+    transport->close();
+
+    // 等待消费者取完再释放共享内存，消费者长时间没有进展时放弃
+    int pending = transport->pending();
+    double progress_time = myslam::FrameTransport::now();
+    while ( !transport->drained() )
+    {
+        if ( transport->pending() < pending )
+        {
+            pending = transport->pending();
+            progress_time = myslam::FrameTransport::now();
+        }
+        else if ( myslam::FrameTransport::now() - progress_time > timeout )
+        {
+            cerr<<pending<<" frames not consumed after "<<timeout<<" s, the consumer seems to be gone"<<endl;
+            return 1;
+        }
+        std::this_thread::sleep_for ( std::chrono::milliseconds ( 1 ) );
+    }
+
+    double elapsed = myslam::FrameTransport::now() - start_time;
+    cout<<"published "<<published<<" frames in "<<elapsed<<" s, "
+        <<published/elapsed<<" fps, waited on full ring "<<full_waits<<" times"<<endl;
+    if ( skipped > 0 )
+        cout<<"skipped "<<skipped<<" frames that did not match the ring slots"<<endl;
+    return 0;
+}
@@ -1,6 +1,12 @@
 #include <iostream>
 #include <vector>
 #include <fstream>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <functional>
+#include <sstream>
+#include <iomanip>
 using namespace std;
 #include <boost/timer.hpp>
 
@@ -17,73 +23,157 @@ using namespace Eigen;
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 using namespace cv;
 
+#include "remode_dataset.h"
+
 // ------------------------------------------------------------------
 // 参数
 const int boarder = 20;     // 边缘宽度
-const int width = 640;      // 宽度 
-const int height = 480;      // 高度
-const double fx = 481.2f;    // 相机内参
-const double fy = -480.0f;
-const double cx = 319.5f;
-const double cy = 239.5f;
 const int ncc_window_size = 2;    // NCC 取的窗口半宽度
 const int ncc_area = (2 * ncc_window_size + 1)*(2 * ncc_window_size + 1); // NCC窗口面积
+const int ncc_batch = 8;    // 一次计算 NCC 的极线采样点数
+const int max_epipolar_samples = 300;    // 极线上采样点数的上限，半长度不超过 100、步长 0.7
+const double init_depth = 3.0;    // 深度初始值
+const double init_cov2 = 3.0;    // 方差初始值
 const double min_cov = 0.1;    // 收敛判定：最小方差
 const double max_cov = 10;    // 发散判定：最大方差
+const int tile_rows = 4;    // 活跃像素按行分块调度，每块的行数
+const int dump_interval = 10;    // 无界面运行时每隔多少帧输出一次深度、方差和点云
+const double pyramid_min_half_length = 4;    // 极线段半长度不小于此值(像素)时先在半分辨率上搜索
+const double pyramid_step = 2.0;    // 半分辨率上的搜索步长，以全分辨率像素计，即半分辨率下 1 像素
+const int pyramid_candidates = 3;    // 半分辨率上保留的候选数
+const int pyramid_refine_steps = 3;    // 全分辨率上在每个候选两侧各细搜的步数
+const double pyramid_min_ncc = 0.5;    // 半分辨率上候选的最低 NCC
+
+// ------------------------------------------------------------------
+// 逐像素的核函数都以标量类型 T 为模板参数：T=double 与原来的计算一致，T=float 时向量化宽度加倍。
+// 深度种子始终以 float 存放，读出后转换为 T。位姿仍以 double 的 SE3 读入，进入核函数前转换为 T
+template<typename T> using Vec2 = Matrix<T, 2, 1>;
+template<typename T> using Vec3 = Matrix<T, 3, 1>;
+template<typename T> using Mat33 = Matrix<T, 3, 3>;
 
 // ------------------------------------------------------------------
 // 重要的函数 
-// 从 REMODE 数据集读取数据  
-bool readDatasetFiles(
-    const string& path,
-    vector<string>& color_image_files,
-    vector<SE3>& poses
-);
 
-// 根据新的图像更新深度估计
+// 参考帧上逐像素的深度种子，按结构数组存放：深度均值、方差为 CV_32F，收敛标志为 CV_8U。
+// 不论用哪种精度计算都以 float 存放，内存是两张 CV_64F 图的一半
+struct DepthSeeds
+{
+    Mat mean;
+    Mat cov;
+    Mat converged;
+};
+
+// 全部种子设为初始值
+void initDepthSeeds(DepthSeeds& seeds);
+
+// 参考帧切换时，把已收敛的种子按新参考帧到旧参考帧的相对位姿 T_N_R 重投影到新参考帧，仍记为收敛，
+// 多个种子落到同一像素时保留最近的，其余像素重新初始化；返回传播过去的种子数
+int propagateDepthSeeds(const DepthSeeds& seeds, const SE3& T_N_R, DepthSeeds& propagated);
+
+// 尚未收敛也未发散的像素，下标 y*width+x 按行优先存放；tile_begin 为每个行块在 index 中的起点，末尾多存一个终点
+struct ActivePixels
+{
+    vector<int> index;
+    vector<int> tile_begin;
+};
+
+// 边框内尚未收敛的像素都设为活跃
+void initActivePixels(const DepthSeeds& seeds, ActivePixels& active);
+
+// 去掉已收敛或发散的像素，重建行块；收敛的像素记下收敛标志
+void compactActivePixels(DepthSeeds& seeds, ActivePixels& active);
+
+// 根据新的图像更新活跃像素的深度种子，核函数用精度 T 计算，更新后压缩活跃像素
+// coarse_to_fine 为真时用 epipolarSearchPyramid，否则用 epipolarSearch
+template<typename T>
 bool update(
     const Mat& ref,
     const Mat& curr,
     const SE3& T_C_R,
-    Mat& depth,
-    Mat& depth_cov
+    DepthSeeds& seeds,
+    ActivePixels& active,
+    bool coarse_to_fine
 );
 
-// 极线搜索 
+// 极线搜索，R_C_R, t_C_R 为参考帧到当前帧的变换
+template<typename T>
 bool epipolarSearch(
     const Mat& ref,
     const Mat& curr,
-    const SE3& T_C_R,
-    const Vector2d& pt_ref,
-    const double& depth_mu,
-    const double& depth_cov,
-    Vector2d& pt_curr
+    const Mat33<T>& R_C_R,
+    const Vec3<T>& t_C_R,
+    const Vec2<T>& pt_ref,
+    const T& depth_mu,
+    const T& depth_cov,
+    Vec2<T>& pt_curr
 );
 
-// 更新深度滤波器 
+// 由粗到精的极线搜索，参数与 epipolarSearch 相同，另加两帧的半分辨率图像：
+// 先在半分辨率上沿整条极线段搜索，只在最好的几个候选附近做全分辨率搜索，最后用抛物线拟合得到亚像素位置
+template<typename T>
+bool epipolarSearchPyramid(
+    const Mat& ref,
+    const Mat& curr,
+    const Mat& ref_half,
+    const Mat& curr_half,
+    const Mat33<T>& R_C_R,
+    const Vec3<T>& t_C_R,
+    const Vec2<T>& pt_ref,
+    const T& depth_mu,
+    const T& depth_cov,
+    Vec2<T>& pt_curr
+);
+
+// 按深度均值和 ±3σ 计算当前帧中的极线段：中心、两端点、单位方向和半长度(不超过 100)
+template<typename T>
+void epipolarSegment(
+    const Mat33<T>& R_C_R,
+    const Vec3<T>& t_C_R,
+    const Vec2<T>& pt_ref,
+    const T& depth_mu,
+    const T& depth_cov,
+    Vec2<T>& px_mean_curr,
+    Vec2<T>& px_min_curr,
+    Vec2<T>& px_max_curr,
+    Vec2<T>& epipolar_direction,
+    T& half_length
+);
+
+// 更新深度滤波器，R_R_C, t_R_C 为当前帧到参考帧的变换
+template<typename T>
 bool updateDepthFilter(
-    const Vector2d& pt_ref,
-    const Vector2d& pt_curr,
-    const SE3& T_C_R,
-    Mat& depth,
-    Mat& depth_cov
+    const Vec2<T>& pt_ref,
+    const Vec2<T>& pt_curr,
+    const Mat33<T>& R_R_C,
+    const Vec3<T>& t_R_C,
+    DepthSeeds& seeds
 );
 
-// 计算 NCC 评分 
-double NCC(const Mat& ref, const Mat& curr, const Vector2d& pt_ref, const Vector2d& pt_curr);
-
-// 双线性灰度插值 
-inline double getBilinearInterpolatedValue(const Mat& img, const Vector2d& pt) {
-    uchar* d = &img.data[int(pt(1, 0))*img.step + int(pt(0, 0))];
-    double xx = pt(0, 0) - floor(pt(0, 0));
-    double yy = pt(1, 0) - floor(pt(1, 0));
-    return  ((1 - xx) * (1 - yy) * double(d[0]) +
-        xx * (1 - yy) * double(d[1]) +
-        (1 - xx) *yy* double(d[img.step]) +
-        xx * yy*double(d[img.step + 1])) / 255.0;
-}
+// NCC 的参考块：灰度归一化到 [0,1] 并去均值，连同平方和在每个像素的极线搜索前只算一次
+template<typename T>
+struct NCCReference
+{
+    T values[ncc_area];
+    T sum_sq;
+};
+
+// 准备参考帧 pt_ref 处的参考块，pt_ref 可以不是整数
+template<typename T>
+void prepareNCCReference(const Mat& ref, const Vec2<T>& pt_ref, NCCReference<T>& reference);
+
+// 计算极线上一批采样点 (xs[k], ys[k]) 与参考块的 NCC 评分，n 不超过 ncc_batch
+template<typename T>
+void NCCBatch(const Mat& curr, const NCCReference<T>& reference, const T* xs, const T* ys, int n, T* scores);
+#ifdef __AVX2__
+template<>
+void NCCBatch<float>(const Mat& curr, const NCCReference<float>& reference, const float* xs, const float* ys, int n, float* scores);
+#endif
 
 // ------------------------------------------------------------------
 // 一些小工具 
@@ -91,24 +181,27 @@ inline double getBilinearInterpolatedValue(const Mat& img, const Vector2d& pt) {
 bool plotDepth(const Mat& depth);
 
 // 像素到相机坐标系 
-inline Vector3d px2cam(const Vector2d px) {
-    return Vector3d(
-        (px(0, 0) - cx) / fx,
-        (px(1, 0) - cy) / fy,
+template<typename T>
+inline Vec3<T> px2cam(const Vec2<T> px) {
+    return Vec3<T>(
+        (px(0, 0) - T(cx)) / T(fx),
+        (px(1, 0) - T(cy)) / T(fy),
         1
     );
 }
 
 // 相机坐标系到像素 
-inline Vector2d cam2px(const Vector3d p_cam) {
-    return Vector2d(
-        p_cam(0, 0)*fx / p_cam(2, 0) + cx,
-        p_cam(1, 0)*fy / p_cam(2, 0) + cy
+template<typename T>
+inline Vec2<T> cam2px(const Vec3<T> p_cam) {
+    return Vec2<T>(
+        p_cam(0, 0)*T(fx) / p_cam(2, 0) + T(cx),
+        p_cam(1, 0)*T(fy) / p_cam(2, 0) + T(cy)
     );
 }
 
 // 检测一个点是否在图像边框内
-inline bool inside(const Vector2d& pt) {
+template<typename T>
+inline bool inside(const Vec2<T>& pt) {
     return pt(0, 0) >= boarder && pt(1, 0) >= boarder
         && pt(0, 0) + boarder < width && pt(1, 0) + boarder <= height;
 }
@@ -118,20 +211,53 @@ void showEpipolarMatch(const Mat& ref, const Mat& curr, const Vector2d& px_ref,
 
 // 显示极线 
 void showEpipolarLine(const Mat& ref, const Mat& curr, const Vector2d& px_ref, const Vector2d& px_min_curr, const Vector2d& px_max_curr);
+
+// 读入灰度图，在后台线程中预取下一帧时使用
+Mat loadGray(const string& file);
+
+// 输出收敛的深度种子：prefix_depth.bin 与 prefix_cov.bin 先写行数、列数 (int32)，再按行优先写 float，
+// 未收敛的像素记为 NaN；prefix_cloud.ply 为世界坐标系下的二进制点云，颜色取自参考帧图像 ref_file
+bool saveDepthSeeds(const DepthSeeds& seeds, const SE3& pose_ref_TWC, const string& ref_file, const string& prefix);
+
+// 用精度 T 跑完整个序列，返回最后一个参考帧上的深度种子，seconds 为 update 的总耗时
+// keyframe_interval 大于 0 时每隔这么多帧把当前帧换成新的参考帧，否则始终以第一帧为参考帧
+// 下一帧图像总是在后台读取；output_dir 非空时每隔 dump_interval 帧、切换参考帧前和最后一帧在后台输出深度种子，
+// 并打印每帧的耗时
+template<typename T>
+DepthSeeds runDenseMapping(const vector<string>& color_image_files, const PoseVector& poses_TWC, bool show,
+    bool coarse_to_fine, int keyframe_interval, const string& output_dir, double& seconds);
 // ------------------------------------------------------------------
 
 
 int main(int argc, char** argv)
 {
-    if (argc != 2)
+    if (argc < 2 || argc > 6)
     {
-        cout << "Usage: dense_mapping path_to_test_dataset" << endl;
+        cout << "Usage: dense_mapping path_to_test_dataset [double|float|compare] [full|pyramid] [keyframe_interval] [output_dir]" << endl;
         return -1;
     }
+    string mode = argc >= 3 ? argv[2] : "double";
+    if (mode != "double" && mode != "float" && mode != "compare")
+    {
+        cout << "unknown mode " << mode << endl;
+        return -1;
+    }
+    // 极线搜索方式：默认 full 在全分辨率上逐点搜索整条极线段，与原来一致；pyramid 由粗到精
+    string search = argc >= 4 ? argv[3] : "full";
+    if (search != "pyramid" && search != "full")
+    {
+        cout << "unknown search " << search << endl;
+        return -1;
+    }
+    const bool coarse_to_fine = search == "pyramid";
+    // 参考帧切换间隔，0 表示始终以第一帧为参考帧
+    const int keyframe_interval = argc >= 5 ? atoi(argv[4]) : 0;
+    // 给出输出目录时不显示图像，深度和点云写到该目录下
+    const string output_dir = argc == 6 ? argv[5] : "";
 
     // 从数据集读取数据
     vector<string> color_image_files;
-    vector<SE3> poses_TWC;
+    PoseVector poses_TWC;
     bool ret = readDatasetFiles(argv[1], color_image_files, poses_TWC);
     if (ret == false)
     {
@@ -140,193 +266,706 @@ int main(int argc, char** argv)
     }
     cout << "read total " << color_image_files.size() << " files." << endl;
 
+    if (mode == "compare")
+    {
+        // 不显示图像，两种精度各跑一遍，比较耗时和深度差异
+        double time_double = 0, time_float = 0;
+        DepthSeeds seeds_double = runDenseMapping<double>(color_image_files, poses_TWC, false, coarse_to_fine, keyframe_interval, "", time_double);
+        DepthSeeds seeds_float = runDenseMapping<float>(color_image_files, poses_TWC, false, coarse_to_fine, keyframe_interval, "", time_float);
+
+        // 匹配结果取决于 NCC 阈值，两种精度下个别像素会走不同的分支，因此只比较两边都收敛的像素
+        double sum = 0, max_diff = 0;
+        int converged_double = 0, converged_float = 0, count = 0, large = 0;
+        for (int y = boarder; y < height - boarder; y++)
+            for (int x = boarder; x < width - boarder; x++)
+            {
+                bool ok_double = seeds_double.converged.ptr<uchar>(y)[x];
+                bool ok_float = seeds_float.converged.ptr<uchar>(y)[x];
+                converged_double += ok_double;
+                converged_float += ok_float;
+                if (!ok_double || !ok_float) continue;
+                double diff = fabs(seeds_double.mean.ptr<float>(y)[x] - seeds_float.mean.ptr<float>(y)[x]);
+                sum += diff;
+                max_diff = max(max_diff, diff);
+                if (diff > 0.01) large++;
+                count++;
+            }
+        cout << "double: " << time_double << " s, float: " << time_float << " s, speedup " << time_double / time_float << "x" << endl;
+        cout << "converged pixels: double " << converged_double << ", float " << converged_float << ", both " << count << endl;
+        if (count > 0)
+            cout << "depth difference on converged pixels: mean " << sum / count << " m, max " << max_diff << " m, "
+                << 100.0 * large / count << "% differ by more than 1 cm" << endl;
+        return 0;
+    }
+
+    double seconds = 0;
+    const bool show = output_dir.empty();
+    DepthSeeds seeds = mode == "float" ?
+        runDenseMapping<float>(color_image_files, poses_TWC, show, coarse_to_fine, keyframe_interval, output_dir, seconds) :
+        runDenseMapping<double>(color_image_files, poses_TWC, show, coarse_to_fine, keyframe_interval, output_dir, seconds);
+    cout << "update took " << seconds << " s in total" << endl;
+    if (!show)
+        return 0;
+
+    cout << "estimation returns, saving depth map ..." << endl;
+    imwrite("depth.png", seeds.mean);
+    cout << "done." << endl;
+
+    return 0;
+}
+
+template<typename T>
+DepthSeeds runDenseMapping(const vector<string>& color_image_files, const PoseVector& poses_TWC, bool show,
+    bool coarse_to_fine, int keyframe_interval, const string& output_dir, double& seconds)
+{
     // 第一张图
     Mat ref = imread(color_image_files[0], 0);                // gray-scale image 
     SE3 pose_ref_TWC = poses_TWC[0];
-    double init_depth = 3.0;    // 深度初始值
-    double init_cov2 = 3.0;    // 方差初始值 
-    Mat depth(height, width, CV_64F, init_depth);             // 深度图
-    Mat depth_cov(height, width, CV_64F, init_cov2);          // 深度图方差 
+    int ref_index = 0;
+    DepthSeeds seeds;                                         // 深度图及其方差
+    initDepthSeeds(seeds);
+    ActivePixels active;
+    initActivePixels(seeds, active);
+
+    // 下一帧在后台线程中读取和解码，与 update 重叠
+    const int num_frames = color_image_files.size();
+    future<Mat> prefetch;
+    if (num_frames > 1)
+        prefetch = async(launch::async, loadGray, color_image_files[1]);
+    // 输出同样放到后台，下一次输出前等上一次写完
+    const bool dump = !output_dir.empty();
+    future<bool> writing;
+    auto dumpSeeds = [&](int index)
+    {
+        if (writing.valid() && !writing.get())
+            cerr << "failed to write to " << output_dir << endl;
+        ostringstream prefix;
+        prefix << output_dir << "/" << setfill('0') << setw(4) << index;
+        DepthSeeds snapshot;
+        snapshot.mean = seeds.mean.clone();
+        snapshot.cov = seeds.cov.clone();
+        snapshot.converged = seeds.converged.clone();
+        // 位姿含定长 Eigen 成员，以引用传入，不拷贝到异步任务里
+        writing = async(launch::async, saveDepthSeeds, snapshot, cref(poses_TWC[ref_index]),
+            color_image_files[ref_index], prefix.str());
+    };
+    int num_processed = 0, last_processed = 0, last_dumped = 0;
+    double total_wait = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
 
-    for (int index = 1; index < color_image_files.size(); index++)
+    seconds = 0;
+    for (int index = 1; index < num_frames; index++)
     {
-        cout << "*** loop " << index << " ***" << endl;
-        Mat curr = imread(color_image_files[index], 0);
+        if (show) cout << "*** loop " << index << " ***" << endl;
+        chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+        Mat curr = prefetch.get();
+        if (index + 1 < num_frames)
+            prefetch = async(launch::async, loadGray, color_image_files[index + 1]);
+        const double wait = chrono::duration_cast<chrono::duration<double>>(chrono::steady_clock::now() - t0).count();
+        total_wait += wait;
         if (curr.data == nullptr) continue;
         SE3 pose_curr_TWC = poses_TWC[index];
         SE3 pose_T_C_R = pose_curr_TWC.inverse() * pose_ref_TWC; // 坐标转换关系： T_C_W * T_W_R = T_C_R 
-        update(ref, curr, pose_T_C_R, depth, depth_cov);
-        plotDepth(depth);
-        imshow("image", curr);
-        waitKey(1);
-    }
+        chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+        update<T>(ref, curr, pose_T_C_R, seeds, active, coarse_to_fine);
+        chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+        const double time_used = chrono::duration_cast<chrono::duration<double>>(t2 - t1).count();
+        seconds += time_used;
+        num_processed++;
+        last_processed = index;
+        if (show)
+        {
+            cout << "active pixels: " << active.index.size() << endl;
+            plotDepth(seeds.mean);
+            imshow("image", curr);
+            waitKey(1);
+        }
+        else if (dump)
+            cout << "frame " << index << ": waited " << wait * 1000 << " ms for the image, update "
+                << time_used * 1000 << " ms, active pixels " << active.index.size() << endl;
 
-    cout << "estimation returns, saving depth map ..." << endl;
-    imwrite("depth.png", depth);
-    cout << "done." << endl;
+        const bool last = index + 1 == num_frames;
+        const bool new_reference = keyframe_interval > 0 && index - ref_index >= keyframe_interval && !last;
+        if (dump && (index % dump_interval == 0 || new_reference || last))
+        {
+            dumpSeeds(index);
+            last_dumped = index;
+        }
 
-    return 0;
+        // 当前帧成为新的参考帧，已收敛的深度传播过去，不必从初始值重新收敛
+        if (new_reference)
+        {
+            DepthSeeds propagated;
+            int num_propagated = propagateDepthSeeds(seeds, pose_curr_TWC.inverse() * pose_ref_TWC, propagated);
+            seeds = propagated;
+            ref = curr;
+            pose_ref_TWC = pose_curr_TWC;
+            ref_index = index;
+            initActivePixels(seeds, active);
+            if (show || dump) cout << "new reference frame " << index << ", propagated " << num_propagated << " seeds" << endl;
+        }
+    }
+    // 列表末尾的帧读不出来时 (如文件末尾的空行) 循环里不会输出最终状态，这里补上
+    if (dump && last_processed > last_dumped)
+        dumpSeeds(last_processed);
+    if (writing.valid() && !writing.get())
+        cerr << "failed to write to " << output_dir << endl;
+    if (dump)
+    {
+        double total = chrono::duration_cast<chrono::duration<double>>(chrono::steady_clock::now() - start).count();
+        cout << "processed " << num_processed << " frames in " << total << " s (" << num_processed / total
+            << " frames/s), update " << seconds << " s, waiting for images " << total_wait << " s" << endl;
+    }
+    return seeds;
 }
 
-bool readDatasetFiles(
-    const string& path,
-    vector< string >& color_image_files,
-    std::vector<SE3>& poses
-)
+Mat loadGray(const string& file)
 {
-    ifstream fin(path + "../test_data/first_200_frames_traj_over_table_input_sequence.txt");
-    if (!fin) return false;
+    return imread(file, 0);
+}
 
-    while (!fin.eof())
+bool saveDepthSeeds(const DepthSeeds& seeds, const SE3& pose_ref_TWC, const string& ref_file, const string& prefix)
+{
+    ofstream depth_out(prefix + "_depth.bin", ios::binary), cov_out(prefix + "_cov.bin", ios::binary);
+    if (!depth_out || !cov_out)
+        return false;
+    const int rows = height, cols = width;
+    for (ofstream* out : { &depth_out, &cov_out })
     {
-        // 数据格式：图像文件名 tx, ty, tz, qx, qy, qz, qw ，注意是 TWC 而非 TCW
-        string image;
-        fin >> image;
-        double data[7];
-        for (double& d : data) fin >> d;
-
-        color_image_files.push_back(path + string("/images/") + image);
-        poses.push_back(
-            SE3(Quaterniond(data[6], data[3], data[4], data[5]),
-                Vector3d(data[0], data[1], data[2]))
-        );
-        if (!fin.good()) break;
+        out->write((const char*)&rows, sizeof(rows));
+        out->write((const char*)&cols, sizeof(cols));
     }
-    return true;
+    vector<float> depth_row(width), cov_row(width);
+    int num_points = 0;
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            const bool converged = seeds.converged.ptr<uchar>(y)[x];
+            depth_row[x] = converged ? seeds.mean.ptr<float>(y)[x] : NAN;
+            cov_row[x] = converged ? seeds.cov.ptr<float>(y)[x] : NAN;
+            num_points += converged;
+        }
+        depth_out.write((const char*)depth_row.data(), width * sizeof(float));
+        cov_out.write((const char*)cov_row.data(), width * sizeof(float));
+    }
+
+    // 点云：收敛的像素按深度恢复到世界坐标系，每个点 3 个 float 坐标加 3 个 uchar 颜色，小端存放
+    Mat color = imread(ref_file);
+    ofstream ply(prefix + "_cloud.ply", ios::binary);
+    if (!ply)
+        return false;
+    ply << "ply" << '\n' << "format binary_little_endian 1.0"
+        << '\n' << "element vertex " << num_points
+        << '\n' << "property float x"
+        << '\n' << "property float y"
+        << '\n' << "property float z"
+        << '\n' << "property uchar red"
+        << '\n' << "property uchar green"
+        << '\n' << "property uchar blue"
+        << '\n' << "end_header" << '\n';
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+        {
+            if (!seeds.converged.ptr<uchar>(y)[x])
+                continue;
+            Vector3d f_ref = px2cam(Vector2d(x, y));
+            f_ref.normalize();
+            const Vector3d p = pose_ref_TWC * (f_ref * double(seeds.mean.ptr<float>(y)[x]));
+            const float xyz[3] = { float(p[0]), float(p[1]), float(p[2]) };
+            uchar rgb[3] = { 255, 255, 255 };
+            if (color.data != nullptr && color.channels() == 3)
+            {
+                const uchar* bgr = color.ptr<uchar>(y) + 3 * x;
+                rgb[0] = bgr[2];
+                rgb[1] = bgr[1];
+                rgb[2] = bgr[0];
+            }
+            else if (color.data != nullptr)
+                rgb[0] = rgb[1] = rgb[2] = color.ptr<uchar>(y)[x];
+            ply.write((const char*)xyz, sizeof(xyz));
+            ply.write((const char*)rgb, sizeof(rgb));
+        }
+    return depth_out.good() && cov_out.good() && ply.good();
 }
 
-// 对整个深度图进行更新
-bool update(const Mat& ref, const Mat& curr, const SE3& T_C_R, Mat& depth, Mat& depth_cov)
+void initDepthSeeds(DepthSeeds& seeds)
 {
-#pragma omp parallel for
-    for (int x = boarder; x < width - boarder; x++)
-#pragma omp parallel for
-        for (int y = boarder; y < height - boarder; y++)
+    seeds.mean = Mat(height, width, CV_32F, Scalar(init_depth));
+    seeds.cov = Mat(height, width, CV_32F, Scalar(init_cov2));
+    seeds.converged = Mat(height, width, CV_8U, Scalar(0));
+}
+
+int propagateDepthSeeds(const DepthSeeds& seeds, const SE3& T_N_R, DepthSeeds& propagated)
+{
+    initDepthSeeds(propagated);
+    const Matrix3d R_N_R = T_N_R.rotation_matrix();
+    const Vector3d t_N_R = T_N_R.translation();
+    Mat hit(height, width, CV_8U, Scalar(0));    // 新参考帧上已经有种子落入的像素
+    int count = 0;
+    for (int y = boarder; y < height - boarder; y++)
+        for (int x = boarder; x < width - boarder; x++)
         {
-            // 遍历每个像素
-            if (depth_cov.ptr<double>(y)[x] < min_cov || depth_cov.ptr<double>(y)[x] > max_cov) // 深度已收敛或发散
+            if (!seeds.converged.ptr<uchar>(y)[x])
                 continue;
+            // 深度是沿视线的距离，先恢复参考帧下的三维点，再变换到新参考帧
+            const double depth = seeds.mean.ptr<float>(y)[x];
+            Vector3d f_ref = px2cam(Vector2d(x, y));
+            f_ref.normalize();
+            const Vector3d p_new = R_N_R * (f_ref * depth) + t_N_R;
+            if (p_new(2, 0) <= 0)
+                continue;
+            const Vector2d px_new = cam2px(p_new);
+            const int u = int(px_new(0, 0) + 0.5), v = int(px_new(1, 0) + 0.5);
+            if (!inside(Vector2d(u, v)))
+                continue;
+            const double depth_new = p_new.norm();
+            uchar& h = hit.ptr<uchar>(v)[u];
+            float& mean = propagated.mean.ptr<float>(v)[u];
+            if (h && depth_new >= mean)   // 被更近的种子遮挡
+                continue;
+            count += !h;
+            h = 1;
+            mean = depth_new;
+            // 标准差随深度按比例缩放
+            const double scale = depth_new / depth;
+            propagated.cov.ptr<float>(v)[u] = seeds.cov.ptr<float>(y)[x] * scale * scale;
+            propagated.converged.ptr<uchar>(v)[u] = 1;
+        }
+    return count;
+}
+
+void initActivePixels(const DepthSeeds& seeds, ActivePixels& active)
+{
+    active.index.clear();
+    active.tile_begin.clear();
+    for (int y = boarder; y < height - boarder; y++)
+    {
+        if ((y - boarder) % tile_rows == 0)
+            active.tile_begin.push_back(active.index.size());
+        for (int x = boarder; x < width - boarder; x++)
+            if (!seeds.converged.ptr<uchar>(y)[x])
+                active.index.push_back(y * width + x);
+    }
+    active.tile_begin.push_back(active.index.size());
+}
+
+void compactActivePixels(DepthSeeds& seeds, ActivePixels& active)
+{
+    // 原地过滤，保持行优先的顺序；行块按行号重新划分，空的行块不保留
+    const float* cov = seeds.cov.ptr<float>(0);
+    uchar* converged = seeds.converged.ptr<uchar>(0);
+    size_t n = 0;
+    int last_tile = -1;
+    active.tile_begin.clear();
+    for (size_t i = 0; i < active.index.size(); i++)
+    {
+        const int idx = active.index[i];
+        if (cov[idx] < min_cov) // 深度已收敛
+        {
+            converged[idx] = 1;
+            continue;
+        }
+        if (cov[idx] > max_cov) // 深度已发散
+            continue;
+        const int tile = (idx / width - boarder) / tile_rows;
+        if (tile != last_tile)
+        {
+            active.tile_begin.push_back(n);
+            last_tile = tile;
+        }
+        active.index[n++] = idx;
+    }
+    active.index.resize(n);
+    active.tile_begin.push_back(n);
+}
+
+// 对活跃像素进行更新
+template<typename T>
+bool update(const Mat& ref, const Mat& curr, const SE3& T_C_R, DepthSeeds& seeds, ActivePixels& active,
+    bool coarse_to_fine)
+{
+    // 位姿只转换一次，核函数内全部用 T 计算
+    SE3 T_R_C = T_C_R.inverse();
+    const Mat33<T> R_C_R = T_C_R.rotation_matrix().cast<T>();
+    const Vec3<T> t_C_R = T_C_R.translation().cast<T>();
+    const Mat33<T> R_R_C = T_R_C.rotation_matrix().cast<T>();
+    const Vec3<T> t_R_C = T_R_C.translation().cast<T>();
+    Mat ref_half, curr_half;
+    if (coarse_to_fine)
+    {
+        pyrDown(ref, ref_half);
+        pyrDown(curr, curr_half);
+    }
+
+    // 只遍历活跃像素，行块内按行优先访问，各行块的匹配成功率不同，耗时差别大，用动态调度
+    const int num_tiles = int(active.tile_begin.size()) - 1;
+#pragma omp parallel for schedule(dynamic)
+    for (int tile = 0; tile < num_tiles; tile++)
+        for (int i = active.tile_begin[tile]; i < active.tile_begin[tile + 1]; i++)
+        {
+            const int x = active.index[i] % width, y = active.index[i] / width;
             // 在极线上搜索 (x,y) 的匹配 
-            Vector2d pt_curr;
-            bool ret = epipolarSearch(
-                ref,
-                curr,
-                T_C_R,
-                Vector2d(x, y),
-                depth.ptr<double>(y)[x],
-                sqrt(depth_cov.ptr<double>(y)[x]),
-                pt_curr
-            );
+            Vec2<T> pt_curr;
+            bool ret = coarse_to_fine ?
+                epipolarSearchPyramid<T>(
+                    ref,
+                    curr,
+                    ref_half,
+                    curr_half,
+                    R_C_R,
+                    t_C_R,
+                    Vec2<T>(x, y),
+                    T(seeds.mean.ptr<float>(y)[x]),
+                    sqrt(T(seeds.cov.ptr<float>(y)[x])),
+                    pt_curr
+                ) :
+                epipolarSearch<T>(
+                    ref,
+                    curr,
+                    R_C_R,
+                    t_C_R,
+                    Vec2<T>(x, y),
+                    T(seeds.mean.ptr<float>(y)[x]),
+                    sqrt(T(seeds.cov.ptr<float>(y)[x])),
+                    pt_curr
+                );
 
             if (ret == false) // 匹配失败
                 continue;
 
             // 取消该注释以显示匹配
-            // showEpipolarMatch( ref, curr, Vector2d(x,y), pt_curr );
+            // showEpipolarMatch( ref, curr, Vector2d(x,y), pt_curr.template cast<double>() );
 
             // 匹配成功，更新深度图 
-            updateDepthFilter(Vector2d(x, y), pt_curr, T_C_R, depth, depth_cov);
+            updateDepthFilter<T>(Vec2<T>(x, y), pt_curr, R_R_C, t_R_C, seeds);
         }
+
+    // 去掉本帧收敛或发散的像素，之后的帧不再访问
+    compactActivePixels(seeds, active);
+    return true;
 }
 
 // 极线搜索
+template<typename T>
 bool epipolarSearch(
     const Mat& ref, const Mat& curr,
-    const SE3& T_C_R, const Vector2d& pt_ref,
-    const double& depth_mu, const double& depth_cov,
-    Vector2d& pt_curr)
+    const Mat33<T>& R_C_R, const Vec3<T>& t_C_R,
+    const Vec2<T>& pt_ref,
+    const T& depth_mu, const T& depth_cov,
+    Vec2<T>& pt_curr)
 {
-    Vector3d f_ref = px2cam(pt_ref);
+    Vec2<T> px_mean_curr, px_min_curr, px_max_curr, epipolar_direction;
+    T half_length;
+    epipolarSegment(R_C_R, t_C_R, pt_ref, depth_mu, depth_cov,
+        px_mean_curr, px_min_curr, px_max_curr, epipolar_direction, half_length);
+
+    // 取消此句注释以显示极线（线段）
+    // showEpipolarLine( ref, curr, pt_ref.template cast<double>(), px_min_curr.template cast<double>(), px_max_curr.template cast<double>() );
+
+    // 在极线上搜索，以深度均值点为中心，左右各取半长度；先收集落在图像内的采样点，再按批计算 NCC
+    T xs[max_epipolar_samples], ys[max_epipolar_samples];
+    int n = 0;
+    for (T l = -half_length; l <= half_length && n < max_epipolar_samples; l += T(0.7))  // l+=sqrt(2)
+    {
+        Vec2<T> px_curr = px_mean_curr + l * epipolar_direction;  // 待匹配点
+        if (!inside(px_curr))
+            continue;
+        xs[n] = px_curr(0, 0);
+        ys[n] = px_curr(1, 0);
+        n++;
+    }
+
+    NCCReference<T> reference;
+    prepareNCCReference(ref, pt_ref, reference);
+    T best_ncc = -1.0;
+    int best = -1;
+    T scores[ncc_batch];
+    for (int s = 0; s < n; s += ncc_batch)
+    {
+        const int m = min(ncc_batch, n - s);
+        NCCBatch(curr, reference, xs + s, ys + s, m, scores);
+        for (int k = 0; k < m; k++)
+            if (scores[k] > best_ncc)
+            {
+                best_ncc = scores[k];
+                best = s + k;
+            }
+    }
+    if (best_ncc < 0.85f)      // 只相信 NCC 很高的匹配
+        return false;
+    pt_curr = Vec2<T>(xs[best], ys[best]);
+    return true;
+}
+
+template<typename T>
+void epipolarSegment(
+    const Mat33<T>& R_C_R, const Vec3<T>& t_C_R,
+    const Vec2<T>& pt_ref,
+    const T& depth_mu, const T& depth_cov,
+    Vec2<T>& px_mean_curr, Vec2<T>& px_min_curr, Vec2<T>& px_max_curr,
+    Vec2<T>& epipolar_direction, T& half_length)
+{
+    Vec3<T> f_ref = px2cam(pt_ref);
     f_ref.normalize();
-    Vector3d P_ref = f_ref * depth_mu;    // 参考帧的 P 向量
+    Vec3<T> P_ref = f_ref * depth_mu;    // 参考帧的 P 向量
 
-    Vector2d px_mean_curr = cam2px(T_C_R*P_ref); // 按深度均值投影的像素
-    double d_min = depth_mu - 3 * depth_cov, d_max = depth_mu + 3 * depth_cov;
-    if (d_min < 0.1) d_min = 0.1;
-    Vector2d px_min_curr = cam2px(T_C_R*(f_ref*d_min));    // 按最小深度投影的像素
-    Vector2d px_max_curr = cam2px(T_C_R*(f_ref*d_max));    // 按最大深度投影的像素
+    px_mean_curr = cam2px<T>(R_C_R*P_ref + t_C_R); // 按深度均值投影的像素
+    T d_min = depth_mu - 3 * depth_cov, d_max = depth_mu + 3 * depth_cov;
+    if (d_min < T(0.1)) d_min = T(0.1);
+    px_min_curr = cam2px<T>(R_C_R*(f_ref*d_min) + t_C_R);    // 按最小深度投影的像素
+    px_max_curr = cam2px<T>(R_C_R*(f_ref*d_max) + t_C_R);    // 按最大深度投影的像素
 
-    Vector2d epipolar_line = px_max_curr - px_min_curr;    // 极线（线段形式）
-    Vector2d epipolar_direction = epipolar_line;        // 极线方向 
+    Vec2<T> epipolar_line = px_max_curr - px_min_curr;    // 极线（线段形式）
+    epipolar_direction = epipolar_line;        // 极线方向 
     epipolar_direction.normalize();
-    double half_length = 0.5*epipolar_line.norm();    // 极线线段的半长度
+    half_length = T(0.5)*epipolar_line.norm();    // 极线线段的半长度
     if (half_length > 100) half_length = 100;   // 我们不希望搜索太多东西 
+}
 
-    // 取消此句注释以显示极线（线段）
-    // showEpipolarLine( ref, curr, pt_ref, px_min_curr, px_max_curr );
+template<typename T>
+bool epipolarSearchPyramid(
+    const Mat& ref, const Mat& curr,
+    const Mat& ref_half, const Mat& curr_half,
+    const Mat33<T>& R_C_R, const Vec3<T>& t_C_R,
+    const Vec2<T>& pt_ref,
+    const T& depth_mu, const T& depth_cov,
+    Vec2<T>& pt_curr)
+{
+    Vec2<T> px_mean_curr, px_min_curr, px_max_curr, epipolar_direction;
+    T half_length;
+    epipolarSegment(R_C_R, t_C_R, pt_ref, depth_mu, depth_cov,
+        px_mean_curr, px_min_curr, px_max_curr, epipolar_direction, half_length);
+    // 极线段很短时粗搜省不了多少，直接在全分辨率上搜索
+    if (!(half_length >= T(pyramid_min_half_length)))
+        return epipolarSearch(ref, curr, R_C_R, t_C_R, pt_ref, depth_mu, depth_cov, pt_curr);
 
-    // 在极线上搜索，以深度均值点为中心，左右各取半长度
-    double best_ncc = -1.0;
-    Vector2d best_px_curr;
-    for (double l = -half_length; l <= half_length; l += 0.7)  // l+=sqrt(2) 
+    // 半分辨率上沿整条线段搜索；全分辨率坐标 p 对应半分辨率的 p/2
+    T ls[max_epipolar_samples], xs[max_epipolar_samples], ys[max_epipolar_samples], coarse[max_epipolar_samples];
+    int n = 0;
+    for (T l = -half_length; l <= half_length && n < max_epipolar_samples; l += T(pyramid_step))
     {
-        Vector2d px_curr = px_mean_curr + l * epipolar_direction;  // 待匹配点
+        Vec2<T> px_curr = px_mean_curr + l * epipolar_direction;
         if (!inside(px_curr))
             continue;
-        // 计算待匹配点与参考帧的 NCC
-        double ncc = NCC(ref, curr, pt_ref, px_curr);
-        if (ncc > best_ncc)
+        ls[n] = l;
+        xs[n] = px_curr(0, 0) * T(0.5);
+        ys[n] = px_curr(1, 0) * T(0.5);
+        n++;
+    }
+    NCCReference<T> reference;
+    prepareNCCReference(ref_half, Vec2<T>(pt_ref * T(0.5)), reference);
+    for (int s = 0; s < n; s += ncc_batch)
+        NCCBatch(curr_half, reference, xs + s, ys + s, min(ncc_batch, n - s), coarse + s);
+
+    // 候选为 NCC 最高的几个局部极大值，按 NCC 从高到低排列
+    int candidates[pyramid_candidates];
+    int num_candidates = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (coarse[i] < T(pyramid_min_ncc))
+            continue;
+        if ((i > 0 && coarse[i - 1] > coarse[i]) || (i + 1 < n && coarse[i + 1] >= coarse[i]))
+            continue;
+        int j = min(num_candidates, pyramid_candidates - 1);
+        if (num_candidates == pyramid_candidates && coarse[candidates[j]] >= coarse[i])
+            continue;
+        if (num_candidates < pyramid_candidates)
+            num_candidates++;
+        for (; j > 0 && coarse[candidates[j - 1]] < coarse[i]; j--)
+            candidates[j] = candidates[j - 1];
+        candidates[j] = i;
+    }
+    if (num_candidates == 0)
+        return false;
+
+    // 全分辨率上在每个候选两侧细搜，步长 0.7；scores 按候选分段，每段对应一个窗口，落在边框外的位置记为 -2
+    const int window = 2 * pyramid_refine_steps + 1;
+    T scores[pyramid_candidates * window], batch[ncc_batch];
+    int slots[pyramid_candidates * window];
+    n = 0;
+    for (int c = 0; c < num_candidates; c++)
+        for (int k = 0; k < window; k++)
         {
-            best_ncc = ncc;
-            best_px_curr = px_curr;
+            const int slot = c * window + k;
+            scores[slot] = -2;
+            Vec2<T> px_curr = px_mean_curr + (ls[candidates[c]] + (k - pyramid_refine_steps) * T(0.7)) * epipolar_direction;
+            if (!inside(px_curr))
+                continue;
+            xs[n] = px_curr(0, 0);
+            ys[n] = px_curr(1, 0);
+            slots[n] = slot;
+            n++;
         }
+    prepareNCCReference(ref, pt_ref, reference);
+    for (int s = 0; s < n; s += ncc_batch)
+    {
+        const int m = min(ncc_batch, n - s);
+        NCCBatch(curr, reference, xs + s, ys + s, m, batch);
+        for (int k = 0; k < m; k++)
+            scores[slots[s + k]] = batch[k];
     }
-    if (best_ncc < 0.85f)      // 只相信 NCC 很高的匹配
+    int best = 0;
+    for (int slot = 1; slot < num_candidates * window; slot++)
+        if (scores[slot] > scores[best])
+            best = slot;
+    if (scores[best] < 0.85f)      // 只相信 NCC 很高的匹配
         return false;
-    pt_curr = best_px_curr;
+
+    // 用最佳位置及其左右两点的 NCC 拟合抛物线，顶点即亚像素位置，偏移不超过半步
+    const int k = best % window;
+    T l = ls[candidates[best / window]] + (k - pyramid_refine_steps) * T(0.7);
+    if (k > 0 && k < window - 1 && scores[best - 1] > -2 && scores[best + 1] > -2)
+    {
+        const T a = scores[best - 1], b = scores[best], c = scores[best + 1];
+        const T denominator = a - 2 * b + c;
+        if (denominator < 0)
+            l += T(0.7) * T(0.5) * (a - c) / denominator;
+    }
+    pt_curr = px_mean_curr + l * epipolar_direction;
     return true;
 }
 
-double NCC(
-    const Mat& ref, const Mat& curr,
-    const Vector2d& pt_ref, const Vector2d& pt_curr
-)
+template<typename T>
+void prepareNCCReference(const Mat& ref, const Vec2<T>& pt_ref, NCCReference<T>& reference)
 {
-    // 零均值-归一化互相关
-    // 先算均值
-    double mean_ref = 0, mean_curr = 0;
-    vector<double> values_ref, values_curr; // 参考帧和当前帧的均值
+    // 窗口内的顺序与 NCCBatch 一致：x 在外层，y 在内层；pt_ref 为整数时插值权重为 (1,0,0,0)，等于直接取像素
+    const int x0 = int(pt_ref(0, 0)), y0 = int(pt_ref(1, 0));
+    const T xx = pt_ref(0, 0) - x0, yy = pt_ref(1, 0) - y0;
+    const int step = ref.step;
+    T mean = 0;
+    int i = 0;
     for (int x = -ncc_window_size; x <= ncc_window_size; x++)
-        for (int y = -ncc_window_size; y <= ncc_window_size; y++)
+        for (int y = -ncc_window_size; y <= ncc_window_size; y++, i++)
         {
-            double value_ref = double(ref.ptr<uchar>(int(y + pt_ref(1, 0)))[int(x + pt_ref(0, 0))]) / 255.0;
-            mean_ref += value_ref;
-
-            double value_curr = getBilinearInterpolatedValue(curr, pt_curr + Vector2d(x, y));
-            mean_curr += value_curr;
-
-            values_ref.push_back(value_ref);
-            values_curr.push_back(value_curr);
+            const uchar* d = ref.ptr<uchar>(y0 + y) + x0 + x;
+            reference.values[i] = ((1 - xx) * (1 - yy) * T(d[0]) + xx * (1 - yy) * T(d[1]) +
+                (1 - xx) * yy * T(d[step]) + xx * yy * T(d[step + 1])) / T(255);
+            mean += reference.values[i];
         }
+    mean /= ncc_area;
+    reference.sum_sq = 0;
+    for (int i = 0; i < ncc_area; i++)
+    {
+        reference.values[i] -= mean;
+        reference.sum_sq += reference.values[i] * reference.values[i];
+    }
+}
 
-    mean_ref /= ncc_area;
-    mean_curr /= ncc_area;
+template<typename T>
+void NCCBatch(const Mat& curr, const NCCReference<T>& reference, const T* xs, const T* ys, int n, T* scores)
+{
+    // 零均值-归一化互相关
+    // 整个窗口内一个采样点的双线性权重相同，先按采样点算好；窗口的每个偏移对这一批采样点做同样的运算，
+    // 内层循环沿采样点展开，便于向量化。当前块只需一趟累加和、平方和以及与参考块的内积，
+    // 参考块已去均值，内积中不必再减去当前块的均值
+    const int step = curr.step;
+    int base[ncc_batch];
+    T w00[ncc_batch], w01[ncc_batch], w10[ncc_batch], w11[ncc_batch];
+    T sum[ncc_batch], sum_sq[ncc_batch], cross[ncc_batch];
+    for (int k = 0; k < n; k++)
+    {
+        const int x0 = int(xs[k]), y0 = int(ys[k]);
+        const T xx = xs[k] - x0, yy = ys[k] - y0;
+        base[k] = y0 * step + x0;
+        w00[k] = (1 - xx) * (1 - yy);
+        w01[k] = xx * (1 - yy);
+        w10[k] = (1 - xx) * yy;
+        w11[k] = xx * yy;
+        sum[k] = sum_sq[k] = cross[k] = 0;
+    }
+    int i = 0;
+    for (int x = -ncc_window_size; x <= ncc_window_size; x++)
+        for (int y = -ncc_window_size; y <= ncc_window_size; y++, i++)
+        {
+            const uchar* d = curr.data + y * step + x;
+            const T r = reference.values[i];
+            for (int k = 0; k < n; k++)
+            {
+                const uchar* p = d + base[k];
+                T v = w00[k] * T(p[0]) + w01[k] * T(p[1]) + w10[k] * T(p[step]) + w11[k] * T(p[step + 1]);
+                sum[k] += v;
+                sum_sq[k] += v * v;
+                cross[k] += r * v;
+            }
+        }
+    // 灰度按 [0,1] 计，与参考块一致
+    const T scale = T(1) / T(255);
+    for (int k = 0; k < n; k++)
+    {
+        T mean = sum[k] * scale / ncc_area;
+        T var = sum_sq[k] * scale * scale - mean * mean * ncc_area;
+        scores[k] = cross[k] * scale / sqrt(reference.sum_sq * var + T(1e-10));   // 防止分母出现零
+    }
+}
 
-    // 计算去均值化 NCC
-    double numerator = 0, demoniator1 = 0, demoniator2 = 0;
-    for (int i = 0; i < values_ref.size(); i++)
+#ifdef __AVX2__
+// float 时一批 8 个采样点正好占满一个 AVX 寄存器。窗口的每个偏移对上下两行各做一次 32 位 gather，
+// 取回的 4 个字节中低两个就是双线性插值所需的左右相邻像素；不足 8 个时用最后一个采样点补齐
+template<>
+void NCCBatch<float>(const Mat& curr, const NCCReference<float>& reference, const float* xs, const float* ys, int n, float* scores)
+{
+    const int step = curr.step;
+    alignas(32) int base[ncc_batch];
+    alignas(32) float fx[ncc_batch], fy[ncc_batch];
+    for (int k = 0; k < ncc_batch; k++)
     {
-        double n = (values_ref[i] - mean_ref) * (values_curr[i] - mean_curr);
-        numerator += n;
-        demoniator1 += (values_ref[i] - mean_ref)*(values_ref[i] - mean_ref);
-        demoniator2 += (values_curr[i] - mean_curr)*(values_curr[i] - mean_curr);
+        const int j = min(k, n - 1);
+        const int x0 = int(xs[j]), y0 = int(ys[j]);
+        base[k] = y0 * step + x0;
+        fx[k] = xs[j] - x0;
+        fy[k] = ys[j] - y0;
     }
-    return numerator / sqrt(demoniator1*demoniator2 + 1e-10);   // 防止分母出现零
+    const __m256i vbase = _mm256_load_si256((const __m256i*)base);
+    const __m256 xx = _mm256_load_ps(fx), yy = _mm256_load_ps(fy), one = _mm256_set1_ps(1.0f);
+    const __m256 w00 = _mm256_mul_ps(_mm256_sub_ps(one, xx), _mm256_sub_ps(one, yy));
+    const __m256 w01 = _mm256_mul_ps(xx, _mm256_sub_ps(one, yy));
+    const __m256 w10 = _mm256_mul_ps(_mm256_sub_ps(one, xx), yy);
+    const __m256 w11 = _mm256_mul_ps(xx, yy);
+    const __m256i mask = _mm256_set1_epi32(0xff);
+    const __m256i vstep = _mm256_set1_epi32(step);
+    __m256 sum = _mm256_setzero_ps(), sum_sq = _mm256_setzero_ps(), cross = _mm256_setzero_ps();
+    int i = 0;
+    for (int x = -ncc_window_size; x <= ncc_window_size; x++)
+        for (int y = -ncc_window_size; y <= ncc_window_size; y++, i++)
+        {
+            const __m256i index = _mm256_add_epi32(vbase, _mm256_set1_epi32(y * step + x));
+            const __m256i top = _mm256_i32gather_epi32((const int*)curr.data, index, 1);
+            const __m256i bottom = _mm256_i32gather_epi32((const int*)curr.data, _mm256_add_epi32(index, vstep), 1);
+            const __m256 d00 = _mm256_cvtepi32_ps(_mm256_and_si256(top, mask));
+            const __m256 d01 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(top, 8), mask));
+            const __m256 d10 = _mm256_cvtepi32_ps(_mm256_and_si256(bottom, mask));
+            const __m256 d11 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(bottom, 8), mask));
+            const __m256 v = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(w00, d00), _mm256_mul_ps(w01, d01)),
+                _mm256_add_ps(_mm256_mul_ps(w10, d10), _mm256_mul_ps(w11, d11)));
+            sum = _mm256_add_ps(sum, v);
+            sum_sq = _mm256_add_ps(sum_sq, _mm256_mul_ps(v, v));
+            cross = _mm256_add_ps(cross, _mm256_mul_ps(_mm256_set1_ps(reference.values[i]), v));
+        }
+    const __m256 scale = _mm256_set1_ps(1.0f / 255), area = _mm256_set1_ps(float(ncc_area));
+    const __m256 mean = _mm256_div_ps(_mm256_mul_ps(sum, scale), area);
+    const __m256 var = _mm256_sub_ps(_mm256_mul_ps(sum_sq, _mm256_mul_ps(scale, scale)), _mm256_mul_ps(_mm256_mul_ps(mean, mean), area));
+    const __m256 denominator = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(reference.sum_sq), var), _mm256_set1_ps(1e-10f)));
+    alignas(32) float result[ncc_batch];
+    _mm256_store_ps(result, _mm256_div_ps(_mm256_mul_ps(cross, scale), denominator));
+    for (int k = 0; k < n; k++)
+        scores[k] = result[k];
 }
+#endif
 
+template<typename T>
 bool updateDepthFilter(
-    const Vector2d& pt_ref,
-    const Vector2d& pt_curr,
-    const SE3& T_C_R,
-    Mat& depth,
-    Mat& depth_cov
+    const Vec2<T>& pt_ref,
+    const Vec2<T>& pt_curr,
+    const Mat33<T>& R_R_C,
+    const Vec3<T>& t_R_C,
+    DepthSeeds& seeds
 )
 {
     // 用三角化计算深度
-    SE3 T_R_C = T_C_R.inverse();
-    Vector3d f_ref = px2cam(pt_ref);
+    Vec3<T> f_ref = px2cam(pt_ref);
     f_ref.normalize();
-    Vector3d f_curr = px2cam(pt_curr);
+    Vec3<T> f_curr = px2cam(pt_curr);
     f_curr.normalize();
 
     // 方程
@@ -334,45 +973,47 @@ bool updateDepthFilter(
     // => [ f_ref^T f_ref, -f_ref^T f_cur ] [d_ref] = [f_ref^T t]
     //    [ f_cur^T f_ref, -f_cur^T f_cur ] [d_cur] = [f_cur^T t]
     // 二阶方程用克莱默法则求解并解之
-    Vector3d t = T_R_C.translation();
-    Vector3d f2 = T_R_C.rotation_matrix() * f_curr;
-    Vector2d b = Vector2d(t.dot(f_ref), t.dot(f2));
-    double A[4];
+    const Vec3<T>& t = t_R_C;
+    Vec3<T> f2 = R_R_C * f_curr;
+    Vec2<T> b = Vec2<T>(t.dot(f_ref), t.dot(f2));
+    T A[4];
     A[0] = f_ref.dot(f_ref);
     A[2] = f_ref.dot(f2);
     A[1] = -A[2];
     A[3] = -f2.dot(f2);
-    double d = A[0] * A[3] - A[1] * A[2];
-    Vector2d lambdavec =
-        Vector2d(A[3] * b(0, 0) - A[1] * b(1, 0),
+    T d = A[0] * A[3] - A[1] * A[2];
+    Vec2<T> lambdavec =
+        Vec2<T>(A[3] * b(0, 0) - A[1] * b(1, 0),
             -A[2] * b(0, 0) + A[0] * b(1, 0)) / d;
-    Vector3d xm = lambdavec(0, 0) * f_ref;
-    Vector3d xn = t + lambdavec(1, 0) * f2;
-    Vector3d d_esti = (xm + xn) / 2.0;  // 三角化算得的深度向量
-    double depth_estimation = d_esti.norm();   // 深度值
+    Vec3<T> xm = lambdavec(0, 0) * f_ref;
+    Vec3<T> xn = t + lambdavec(1, 0) * f2;
+    Vec3<T> d_esti = (xm + xn) / T(2);  // 三角化算得的深度向量
+    T depth_estimation = d_esti.norm();   // 深度值
 
     // 计算不确定性（以一个像素为误差）
-    Vector3d p = f_ref * depth_estimation;
-    Vector3d a = p - t;
-    double t_norm = t.norm();
-    double a_norm = a.norm();
-    double alpha = acos(f_ref.dot(t) / t_norm);
-    double beta = acos(-a.dot(t) / (a_norm*t_norm));
-    double beta_prime = beta + atan(1 / fx);
-    double gamma = M_PI - alpha - beta_prime;
-    double p_prime = t_norm * sin(beta_prime) / sin(gamma);
-    double d_cov = p_prime - depth_estimation;
-    double d_cov2 = d_cov * d_cov;
+    Vec3<T> p = f_ref * depth_estimation;
+    Vec3<T> a = p - t;
+    T t_norm = t.norm();
+    T a_norm = a.norm();
+    T alpha = acos(f_ref.dot(t) / t_norm);
+    T beta = acos(-a.dot(t) / (a_norm*t_norm));
+    T beta_prime = beta + atan(T(1) / T(fx));
+    T gamma = T(M_PI) - alpha - beta_prime;
+    T p_prime = t_norm * sin(beta_prime) / sin(gamma);
+    T d_cov = p_prime - depth_estimation;
+    T d_cov2 = d_cov * d_cov;
 
     // 高斯融合
-    double mu = depth.ptr<double>(int(pt_ref(1, 0)))[int(pt_ref(0, 0))];
-    double sigma2 = depth_cov.ptr<double>(int(pt_ref(1, 0)))[int(pt_ref(0, 0))];
+    float& mean = seeds.mean.ptr<float>(int(pt_ref(1, 0)))[int(pt_ref(0, 0))];
+    float& cov = seeds.cov.ptr<float>(int(pt_ref(1, 0)))[int(pt_ref(0, 0))];
+    T mu = mean;
+    T sigma2 = cov;
 
-    double mu_fuse = (d_cov2*mu + sigma2 * depth_estimation) / (sigma2 + d_cov2);
-    double sigma_fuse2 = (sigma2 * d_cov2) / (sigma2 + d_cov2);
+    T mu_fuse = (d_cov2*mu + sigma2 * depth_estimation) / (sigma2 + d_cov2);
+    T sigma_fuse2 = (sigma2 * d_cov2) / (sigma2 + d_cov2);
 
-    depth.ptr<double>(int(pt_ref(1, 0)))[int(pt_ref(0, 0))] = mu_fuse;
-    depth_cov.ptr<double>(int(pt_ref(1, 0)))[int(pt_ref(0, 0))] = sigma_fuse2;
+    mean = mu_fuse;
+    cov = sigma_fuse2;
 
     return true;
 }
@@ -382,6 +1023,7 @@ bool plotDepth(const Mat& depth)
 {
     imshow("depth", depth*0.4);
     waitKey(1);
+    return true;
 }
 
 // 显示极线匹配
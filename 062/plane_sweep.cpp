@@ -0,0 +1,393 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+// for sophus
+#include <sophus/se3.h>
+using Sophus::SE3;
+
+// for eigen
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+using namespace Eigen;
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+using namespace cv;
+
+#include "remode_dataset.h"
+
+/**********************************************
+* 平面扫描 (plane sweep) 多视图立体，作为 dense_mapping 之外的另一种稠密深度估计
+* dense_mapping 对每个像素单独做极线搜索，再用深度滤波器逐帧融合；
+* 这里把参考帧之后的若干帧按已知位姿投影到参考帧前方一组正平行平面上，
+* 每个平面上逐像素算 ZNCC 代价并在各源帧间取平均，得到代价体，再赢者通吃取深度，并给出置信度。
+* 所有像素在每个平面上的运算完全相同，访存按行连续，便于向量化；行带之间互不依赖，用 OpenMP 并行
+***********************************************/
+
+// ------------------------------------------------------------------
+// 参数
+const int boarder = 20;     // 边缘宽度
+const int ncc_window_size = 2;    // NCC 取的窗口半宽度
+const int ncc_area = (2 * ncc_window_size + 1)*(2 * ncc_window_size + 1); // NCC窗口面积
+const double min_depth = 0.5;    // 扫描的深度范围(沿相机 z 轴)，平面按逆深度均匀分布
+const double max_depth = 8.0;
+const int band_rows = 16;    // 按行带并行，每个行带的行数
+const int band_cols = width - 2 * boarder;    // 行带内参与计算的列数
+const float invalid_cost = 2;    // 没有任何源帧看得到时的代价，相当于 NCC = -1
+const float min_confidence = 0.2f;    // 统计时认为可信的最低置信度
+
+// ------------------------------------------------------------------
+// 一个源帧：浮点灰度图，以及参考帧到它的单应。
+// 深度 z 的正平行平面上，参考帧像素 p = (x, y, 1) 投到源帧的齐次坐标为 K R K^-1 p + K t / z
+struct SourceView
+{
+    Mat image;          // CV_32F
+    Matrix3f KRK_inv;   // K R K^-1
+    Vector3f Kt;        // K t
+};
+
+// ------------------------------------------------------------------
+// 重要的函数
+// 准备源帧，T_C_R 为参考帧到源帧的变换
+void prepareSource(const Mat& curr, const SE3& T_C_R, SourceView& view);
+
+// 参考帧每个像素 NCC 窗口内的均值和离差平方和，只算边框以内
+void prepareReference(const Mat& ref, Mat& ref_mean, Mat& ref_var);
+
+// 参考帧第 y 行从 x_begin 起的 n 个像素，经逆深度为 inv_depth 的平面投到源帧，双线性插值写入 out；
+// 投到图像外的像素取最近的边缘值，valid 记 0，否则记 1
+void warpRow(const SourceView& view, float inv_depth, int y, int x_begin, int n, float* out, float* valid);
+
+// 在参考帧的行 [y_begin, y_end) 上扫过全部平面：建立该行带的代价体，再赢者通吃写入 depth 和 confidence
+void sweepBand(const Mat& ref, const Mat& ref_mean, const Mat& ref_var, const vector<SourceView>& views,
+    const vector<float>& inv_depths, int y_begin, int y_end, Mat& depth, Mat& confidence);
+
+// 平面扫描的入口：depth 为沿视线的距离(与 dense_mapping 的深度图相同)，confidence 在 [0,1] 内，均为 CV_32F
+void planeSweep(const Mat& ref, const vector<SourceView>& views, int num_planes, Mat& depth, Mat& confidence);
+
+// ------------------------------------------------------------------
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argc > 4)
+    {
+        cout << "Usage: plane_sweep path_to_test_dataset [num_sources] [num_planes]" << endl;
+        return -1;
+    }
+    const int num_sources = argc >= 3 ? atoi(argv[2]) : 10;
+    const int num_planes = argc == 4 ? atoi(argv[3]) : 128;
+    if (num_sources < 1 || num_planes < 3)
+    {
+        cout << "need at least 1 source frame and 3 planes" << endl;
+        return -1;
+    }
+
+    // 从数据集读取数据
+    vector<string> color_image_files;
+    PoseVector poses_TWC;
+    bool ret = readDatasetFiles(argv[1], color_image_files, poses_TWC);
+    if (ret == false)
+    {
+        cout << "Reading image files failed!" << endl;
+        return -1;
+    }
+    cout << "read total " << color_image_files.size() << " files." << endl;
+
+    // 第一张图为参考帧，其后的若干帧为源帧
+    Mat ref = imread(color_image_files[0], 0);
+    if (ref.data == nullptr)
+    {
+        cout << "Reading the reference image failed!" << endl;
+        return -1;
+    }
+    vector<SourceView> views;
+    for (int index = 1; index < color_image_files.size() && views.size() < num_sources; index++)
+    {
+        Mat curr = imread(color_image_files[index], 0);
+        if (curr.data == nullptr) continue;
+        SE3 T_C_R = poses_TWC[index].inverse() * poses_TWC[0]; // 坐标转换关系： T_C_W * T_W_R = T_C_R
+        views.push_back(SourceView());
+        prepareSource(curr, T_C_R, views.back());
+    }
+    if (views.empty())
+    {
+        cout << "no source frames" << endl;
+        return -1;
+    }
+
+    Mat depth, confidence;
+    chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+    planeSweep(ref, views, num_planes, depth, confidence);
+    chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+    double seconds = chrono::duration_cast<chrono::duration<double>>(t2 - t1).count();
+    cout << "plane sweep over " << num_planes << " planes and " << views.size() << " source frames took "
+        << seconds << " s" << endl;
+
+    int confident = 0;
+    for (int y = boarder; y < height - boarder; y++)
+        for (int x = boarder; x < width - boarder; x++)
+            confident += confidence.ptr<float>(y)[x] > min_confidence;
+    cout << "confident pixels: " << 100.0 * confident / ((height - 2 * boarder) * (width - 2 * boarder)) << "%" << endl;
+
+    imshow("depth", depth*0.4);
+    imshow("confidence", confidence);
+    waitKey(0);
+
+    cout << "saving depth map ..." << endl;
+    imwrite("depth_plane_sweep.png", depth);
+    cout << "done." << endl;
+
+    return 0;
+}
+
+void prepareSource(const Mat& curr, const SE3& T_C_R, SourceView& view)
+{
+    Matrix3d K;
+    K << fx, 0, cx, 0, fy, cy, 0, 0, 1;
+    view.KRK_inv = (K * T_C_R.rotation_matrix() * K.inverse()).cast<float>();
+    view.Kt = (K * T_C_R.translation()).cast<float>();
+    curr.convertTo(view.image, CV_32F);
+}
+
+void prepareReference(const Mat& ref, Mat& ref_mean, Mat& ref_var)
+{
+    ref_mean = Mat(height, width, CV_32F, Scalar(0));
+    ref_var = Mat(height, width, CV_32F, Scalar(0));
+    for (int y = boarder; y < height - boarder; y++)
+        for (int x = boarder; x < width - boarder; x++)
+        {
+            float sum = 0, sum_sq = 0;
+            for (int j = -ncc_window_size; j <= ncc_window_size; j++)
+                for (int i = -ncc_window_size; i <= ncc_window_size; i++)
+                {
+                    float v = ref.ptr<uchar>(y + j)[x + i];
+                    sum += v;
+                    sum_sq += v * v;
+                }
+            ref_mean.ptr<float>(y)[x] = sum / ncc_area;
+            ref_var.ptr<float>(y)[x] = sum_sq - sum * sum / ncc_area;
+        }
+}
+
+void warpRow(const SourceView& view, float inv_depth, int y, int x_begin, int n, float* out, float* valid)
+{
+    // 齐次坐标沿行线性变化：q(x) = q0 + x * dq
+    float q0[3], dq[3];
+    for (int k = 0; k < 3; k++)
+    {
+        q0[k] = view.KRK_inv(k, 1) * y + view.KRK_inv(k, 2) + view.Kt[k] * inv_depth;
+        dq[k] = view.KRK_inv(k, 0);
+    }
+    const float* data = view.image.ptr<float>(0);
+    const int step = view.image.step / sizeof(float);
+    // 插值的左上角不超过倒数第二行、列
+    const float max_u = width - 1.001f, max_v = height - 1.001f;
+    int i = 0;
+#ifdef __AVX2__
+    // 一次 8 个像素，四个相邻像素各用一次 gather 取回
+    const __m256 ramp = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+    const __m256 edge_u = _mm256_set1_ps(float(width - 1)), edge_v = _mm256_set1_ps(float(height - 1));
+    const __m256 clamp_u = _mm256_set1_ps(max_u), clamp_v = _mm256_set1_ps(max_v);
+    const __m256i vstep = _mm256_set1_epi32(step), vone = _mm256_set1_epi32(1);
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m256 x = _mm256_add_ps(_mm256_set1_ps(float(x_begin + i)), ramp);
+        const __m256 w = _mm256_add_ps(_mm256_set1_ps(q0[2]), _mm256_mul_ps(x, _mm256_set1_ps(dq[2])));
+        __m256 u = _mm256_div_ps(_mm256_add_ps(_mm256_set1_ps(q0[0]), _mm256_mul_ps(x, _mm256_set1_ps(dq[0]))), w);
+        __m256 v = _mm256_div_ps(_mm256_add_ps(_mm256_set1_ps(q0[1]), _mm256_mul_ps(x, _mm256_set1_ps(dq[1]))), w);
+        const __m256 inside = _mm256_and_ps(_mm256_cmp_ps(w, zero, _CMP_GT_OQ),
+            _mm256_and_ps(
+                _mm256_and_ps(_mm256_cmp_ps(u, zero, _CMP_GE_OQ), _mm256_cmp_ps(u, edge_u, _CMP_LE_OQ)),
+                _mm256_and_ps(_mm256_cmp_ps(v, zero, _CMP_GE_OQ), _mm256_cmp_ps(v, edge_v, _CMP_LE_OQ))));
+        // 有 NaN 时 max 返回第二个操作数，w 接近 0 产生的 NaN 也被截到 0
+        u = _mm256_min_ps(_mm256_max_ps(u, zero), clamp_u);
+        v = _mm256_min_ps(_mm256_max_ps(v, zero), clamp_v);
+        const __m256i x0 = _mm256_cvttps_epi32(u), y0 = _mm256_cvttps_epi32(v);
+        const __m256 ax = _mm256_sub_ps(u, _mm256_cvtepi32_ps(x0)), ay = _mm256_sub_ps(v, _mm256_cvtepi32_ps(y0));
+        const __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(y0, vstep), x0);
+        const __m256i below = _mm256_add_epi32(index, vstep);
+        const __m256 p00 = _mm256_i32gather_ps(data, index, 4);
+        const __m256 p01 = _mm256_i32gather_ps(data, _mm256_add_epi32(index, vone), 4);
+        const __m256 p10 = _mm256_i32gather_ps(data, below, 4);
+        const __m256 p11 = _mm256_i32gather_ps(data, _mm256_add_epi32(below, vone), 4);
+        const __m256 top = _mm256_add_ps(p00, _mm256_mul_ps(ax, _mm256_sub_ps(p01, p00)));
+        const __m256 bottom = _mm256_add_ps(p10, _mm256_mul_ps(ax, _mm256_sub_ps(p11, p10)));
+        _mm256_storeu_ps(out + i, _mm256_add_ps(top, _mm256_mul_ps(ay, _mm256_sub_ps(bottom, top))));
+        _mm256_storeu_ps(valid + i, _mm256_and_ps(inside, one));
+    }
+#endif
+    for (; i < n; i++)
+    {
+        const float x = x_begin + i;
+        const float w = q0[2] + x * dq[2];
+        float u = (q0[0] + x * dq[0]) / w, v = (q0[1] + x * dq[1]) / w;
+        valid[i] = w > 0 && u >= 0 && u <= width - 1 && v >= 0 && v <= height - 1;
+        // 写成比较的形式，NaN 也被截到 0
+        u = u > 0 ? (u < max_u ? u : max_u) : 0;
+        v = v > 0 ? (v < max_v ? v : max_v) : 0;
+        const int x0 = int(u), y0 = int(v);
+        const float ax = u - x0, ay = v - y0;
+        const float* p = data + y0 * step + x0;
+        const float top = p[0] + ax * (p[1] - p[0]);
+        const float bottom = p[step] + ax * (p[step + 1] - p[step]);
+        out[i] = top + ay * (bottom - top);
+    }
+}
+
+void sweepBand(const Mat& ref, const Mat& ref_mean, const Mat& ref_var, const vector<SourceView>& views,
+    const vector<float>& inv_depths, int y_begin, int y_end, Mat& depth, Mat& confidence)
+{
+    const int window = 2 * ncc_window_size + 1;
+    const int rows = y_end - y_begin;
+    const int warp_rows = rows + 2 * ncc_window_size;     // 上下各多变换窗口半宽度的行
+    const int warp_cols = band_cols + 2 * ncc_window_size;
+    const int x_begin = boarder - ncc_window_size;
+    const int n = rows * band_cols;
+    const int num_planes = inv_depths.size();
+
+    vector<float> warped(warp_rows * warp_cols), valid(warp_rows * warp_cols), product(warp_rows * warp_cols);
+    vector<float> col_sum(warp_cols), col_sum_sq(warp_cols), col_cross(warp_cols);
+    vector<float> cost_sum(n), count(n);
+    vector<float> volume(num_planes * n);   // 代价体，按平面存放
+
+    for (int k = 0; k < num_planes; k++)
+    {
+        fill(cost_sum.begin(), cost_sum.end(), 0.0f);
+        fill(count.begin(), count.end(), 0.0f);
+        for (const SourceView& view : views)
+        {
+            for (int r = 0; r < warp_rows; r++)
+            {
+                float* w = &warped[r * warp_cols];
+                float* p = &product[r * warp_cols];
+                warpRow(view, inv_depths[k], y_begin - ncc_window_size + r, x_begin, warp_cols, w, &valid[r * warp_cols]);
+                const uchar* ref_row = ref.ptr<uchar>(y_begin - ncc_window_size + r) + x_begin;
+                for (int x = 0; x < warp_cols; x++)
+                    p[x] = ref_row[x] * w[x];
+            }
+            // 窗口和先沿列累加窗口内的行，再沿行累加窗口内的列，两步的内层循环都是连续访存
+            for (int r = 0; r < rows; r++)
+            {
+                fill(col_sum.begin(), col_sum.end(), 0.0f);
+                fill(col_sum_sq.begin(), col_sum_sq.end(), 0.0f);
+                fill(col_cross.begin(), col_cross.end(), 0.0f);
+                for (int j = 0; j < window; j++)
+                {
+                    const float* w = &warped[(r + j) * warp_cols];
+                    const float* p = &product[(r + j) * warp_cols];
+                    for (int x = 0; x < warp_cols; x++)
+                    {
+                        col_sum[x] += w[x];
+                        col_sum_sq[x] += w[x] * w[x];
+                        col_cross[x] += p[x];
+                    }
+                }
+                const float* mean = ref_mean.ptr<float>(y_begin + r) + boarder;
+                const float* var = ref_var.ptr<float>(y_begin + r) + boarder;
+                const float* center = &valid[(r + ncc_window_size) * warp_cols + ncc_window_size];
+                float* cs = &cost_sum[r * band_cols];
+                float* c = &count[r * band_cols];
+                for (int x = 0; x < band_cols; x++)
+                {
+                    float sum = 0, sum_sq = 0, cross = 0;
+                    for (int i = 0; i < window; i++)
+                    {
+                        sum += col_sum[x + i];
+                        sum_sq += col_sum_sq[x + i];
+                        cross += col_cross[x + i];
+                    }
+                    // 零均值-归一化互相关，参考块的均值和离差平方和事先算好
+                    const float numerator = cross - mean[x] * sum;
+                    // 平坦或边缘钳位的窗口上舍入误差会让离差平方和略小于零，钳到零以免开方得到 NaN
+                    const float var_curr = max(sum_sq - sum * sum / ncc_area, 0.0f);
+                    const float ncc = numerator / sqrt(var[x] * var_curr + 1e-10f);   // 防止分母出现零
+                    // 只计入窗口中心投到源帧图像内的源帧；用分支而不是乘以 valid，无效样本的值不会带进代价
+                    if (center[x] > 0)
+                    {
+                        cs[x] += 1 - ncc;
+                        c[x] += 1;
+                    }
+                }
+            }
+        }
+        float* slice = &volume[k * n];
+        for (int i = 0; i < n; i++)
+            slice[i] = count[i] > 0 ? cost_sum[i] / count[i] : invalid_cost;
+    }
+
+    // 赢者通吃：每个像素取代价最小的平面；不与之相邻的平面中的最小代价作为次优，两者之比给出置信度
+    vector<int> best(n, 0);
+    vector<float> best_cost(volume.begin(), volume.begin() + n), second_cost(n, invalid_cost);
+    for (int k = 1; k < num_planes; k++)
+    {
+        const float* slice = &volume[k * n];
+        for (int i = 0; i < n; i++)
+            if (slice[i] < best_cost[i])
+            {
+                best_cost[i] = slice[i];
+                best[i] = k;
+            }
+    }
+    for (int k = 0; k < num_planes; k++)
+    {
+        const float* slice = &volume[k * n];
+        for (int i = 0; i < n; i++)
+            if (abs(k - best[i]) > 1)
+                second_cost[i] = min(second_cost[i], slice[i]);
+    }
+    const float inv_depth_step = inv_depths[1] - inv_depths[0];
+    for (int i = 0; i < n; i++)
+    {
+        const int y = y_begin + i / band_cols, x = boarder + i % band_cols;
+        const int k = best[i];
+        // 用最优平面及其前后两个平面的代价拟合抛物线，顶点即亚平面间隔的逆深度
+        float offset = 0;
+        if (k > 0 && k < num_planes - 1)
+        {
+            const float a = volume[(k - 1) * n + i], b = best_cost[i], c = volume[(k + 1) * n + i];
+            const float denominator = a - 2 * b + c;
+            if (denominator > 0)
+                offset = 0.5f * (a - c) / denominator;
+        }
+        const float inv_depth = inv_depths[k] + offset * inv_depth_step;
+        // 平面深度是 z，转成沿视线的距离
+        const float ray_x = (x - cx) / fx, ray_y = (y - cy) / fy;
+        depth.ptr<float>(y)[x] = sqrt(ray_x * ray_x + ray_y * ray_y + 1) / inv_depth;
+        confidence.ptr<float>(y)[x] = second_cost[i] > 0 ? max(0.0f, 1 - best_cost[i] / second_cost[i]) : 0;
+    }
+}
+
+void planeSweep(const Mat& ref, const vector<SourceView>& views, int num_planes, Mat& depth, Mat& confidence)
+{
+    Mat ref_mean, ref_var;
+    prepareReference(ref, ref_mean, ref_var);
+
+    // 平面按逆深度均匀分布，同一基线下相邻平面的视差相同
+    vector<float> inv_depths(num_planes);
+    for (int k = 0; k < num_planes; k++)
+        inv_depths[k] = 1.0 / max_depth + k * (1.0 / min_depth - 1.0 / max_depth) / (num_planes - 1);
+
+    depth = Mat(height, width, CV_32F, Scalar(0));
+    confidence = Mat(height, width, CV_32F, Scalar(0));
+    const int num_bands = (height - 2 * boarder + band_rows - 1) / band_rows;
+#pragma omp parallel for schedule(dynamic)
+    for (int b = 0; b < num_bands; b++)
+    {
+        const int y_begin = boarder + b * band_rows;
+        const int y_end = min(y_begin + band_rows, height - boarder);
+        sweepBand(ref, ref_mean, ref_var, views, inv_depths, y_begin, y_end, depth, confidence);
+    }
+}
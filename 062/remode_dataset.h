@@ -0,0 +1,54 @@
+#ifndef REMODE_DATASET_H
+#define REMODE_DATASET_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include <sophus/se3.h>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+// REMODE 数据集的读取和相机参数，dense_mapping 与 plane_sweep 共用
+
+// ------------------------------------------------------------------
+// 参数
+const int width = 640;      // 宽度
+const int height = 480;      // 高度
+const double fx = 481.2f;    // 相机内参
+const double fy = -480.0f;
+const double cx = 319.5f;
+const double cy = 239.5f;
+
+// SE3 含定长 Eigen 成员，放进 vector 需要对齐的分配器，否则开启 AVX 时会非对齐访问
+typedef std::vector<Sophus::SE3, Eigen::aligned_allocator<Sophus::SE3>> PoseVector;
+
+// 从 REMODE 数据集读取数据
+inline bool readDatasetFiles(
+    const std::string& path,
+    std::vector< std::string >& color_image_files,
+    PoseVector& poses
+)
+{
+    std::ifstream fin(path + "../test_data/first_200_frames_traj_over_table_input_sequence.txt");
+    if (!fin) return false;
+
+    while (!fin.eof())
+    {
+        // 数据格式：图像文件名 tx, ty, tz, qx, qy, qz, qw ，注意是 TWC 而非 TCW
+        std::string image;
+        fin >> image;
+        double data[7];
+        for (double& d : data) fin >> d;
+
+        color_image_files.push_back(path + std::string("/images/") + image);
+        poses.push_back(
+            Sophus::SE3(Eigen::Quaterniond(data[6], data[3], data[4], data[5]),
+                Eigen::Vector3d(data[0], data[1], data[2]))
+        );
+        if (!fin.good()) break;
+    }
+    return true;
+}
+
+#endif // REMODE_DATASET_H